@@ -0,0 +1,263 @@
+/// @file
+/// Texture atlas used to pack images into a few large textures
+
+#include "Graphics_Imp.h"
+#include <algorithm>
+#include <cassert>
+
+namespace Graphics
+{
+	/// @brief Constructs an AtlasPage object
+	/// @param w Page width
+	/// @param h Page height
+	/// @param format Texel format of page
+	/// @note Tested
+	AtlasPage::AtlasPage (GLsizei w, GLsizei h, GLenum format) : mW(w), mH(h), mFormat(format), mCount(0), mUsed(Main::Get().mFrame)
+	{
+		// Start with a flat skyline across the whole page.
+		Span span = { 0, 0, w };
+
+		mSkyline.push_back(span);
+
+		// Allocate an empty texture; images are uploaded into it as they are packed.
+		mTexture = Main::Get().mBackend->CreateTexture(w, h, format);
+	}
+
+	/// @brief Destructs an AtlasPage object
+	/// @note Tested
+	AtlasPage::~AtlasPage (void)
+	{
+		if (mTexture != 0) Main::Get().mBackend->DeleteTexture(mTexture);
+	}
+
+	/// @brief Reserves a region of the page
+	/// @param w Width of region
+	/// @param h Height of region
+	/// @param x [out] On success, left edge of region
+	/// @param y [out] On success, top edge of region
+	/// @return If true, the region was reserved
+	/// @note Tested
+	bool AtlasPage::Allocate (GLsizei w, GLsizei h, GLint & x, GLint & y)
+	{
+		// Find the span where the region would sit lowest on the skyline.
+		Uint32 best = Uint32(mSkyline.size());
+		GLint bestY = mH;
+
+		for (Uint32 index = 0; index < mSkyline.size(); ++index)
+		{
+			GLint fitY = Fit(index, w, h);
+
+			if (fitY >= 0 && fitY < bestY)
+			{
+				best = index;
+				bestY = fitY;
+			}
+		}
+
+		if (best == mSkyline.size()) return false;
+
+		x = mSkyline[best].mX;
+		y = bestY;
+
+		// Raise the skyline over the region, trimming or removing the spans it covers.
+		Span span = { x, y + h, w };
+
+		mSkyline.insert(mSkyline.begin() + best, span);
+
+		for (Uint32 index = best + 1; index < mSkyline.size(); )
+		{
+			GLint edge = mSkyline[index - 1].mX + mSkyline[index - 1].mW;
+
+			if (mSkyline[index].mX >= edge) break;
+
+			GLint shrink = edge - mSkyline[index].mX;
+
+			mSkyline[index].mX += shrink;
+			mSkyline[index].mW -= shrink;
+
+			if (mSkyline[index].mW > 0) break;
+
+			mSkyline.erase(mSkyline.begin() + index);
+		}
+
+		// Merge neighboring spans of equal height.
+		for (Uint32 index = 0; index + 1 < mSkyline.size(); )
+		{
+			if (mSkyline[index].mY == mSkyline[index + 1].mY)
+			{
+				mSkyline[index].mW += mSkyline[index + 1].mW;
+
+				mSkyline.erase(mSkyline.begin() + index + 1);
+			}
+
+			else ++index;
+		}
+
+		++mCount;
+
+		return true;
+	}
+
+	/// @brief Finds where a region would rest if placed at the start of a span
+	/// @param index Index of span
+	/// @param w Width of region
+	/// @param h Height of region
+	/// @return Top edge of region, or -1 if it does not fit
+	/// @note Tested
+	GLint AtlasPage::Fit (Uint32 index, GLsizei w, GLsizei h)
+	{
+		if (mSkyline[index].mX + w > mW) return -1;
+
+		// The region rests on the highest span beneath it.
+		GLint y = 0;
+
+		for (GLint remaining = w; remaining > 0; remaining -= mSkyline[index++].mW)
+		{
+			assert(index < mSkyline.size());
+
+			y = std::max(y, mSkyline[index].mY);
+
+			if (y + h > mH) return -1;
+		}
+
+		return y;
+	}
+
+	/// @brief Uploads an image into its region of the page, surrounded by a copy of its
+	/// outermost texels
+	/// @param pPixels 32-bit RGBA pixels of image
+	/// @param w Image width
+	/// @param h Image height
+	/// @param pitch Bytes per row of pixels
+	/// @param x Left edge of image within page, inside the border
+	/// @param y Top edge of image within page, inside the border
+	/// @note Tested
+	/// @note The border keeps filtering at the image's edges from picking up its neighbors
+	void AtlasPage::UploadExtruded (Uint8 const * pPixels, GLsizei w, GLsizei h, GLsizei pitch, GLint x, GLint y)
+	{
+		// Upload the image, then its left and right edge columns, straight from its rows.
+		Backend * pBackend = Main::Get().mBackend;
+
+		pBackend->UpdateTexture(mTexture, x, y, w, h, pitch, pPixels);
+		pBackend->UpdateTexture(mTexture, x - 1, y, 1, h, pitch, pPixels);
+		pBackend->UpdateTexture(mTexture, x + w, y, 1, h, pitch, pPixels + (w - 1) * 4);
+
+		// The top and bottom edge rows also cover the corners, so assemble them first.
+		std::vector<Uint32> edge(w + 2);
+
+		for (int side = 0; side < 2; ++side)
+		{
+			Uint32 const * pRow = reinterpret_cast<Uint32 const *>(pPixels + side * (h - 1) * pitch);
+
+			std::copy(pRow, pRow + w, edge.begin() + 1);
+
+			edge.front() = pRow[0];
+			edge.back() = pRow[w - 1];
+
+			pBackend->UpdateTexture(mTexture, x - 1, side != 0 ? y + h : y - 1, w + 2, 1, (w + 2) * 4, &edge[0]);
+		}
+	}
+
+	/// @brief Constructs an Atlas object
+	/// @param pageSize Width and height of an ordinary page
+	/// @param format Texel format of pages
+	/// @note Tested
+	Atlas::Atlas (GLsizei pageSize, GLenum format) : mPageSize(pageSize), mFormat(format)
+	{
+	}
+
+	/// @brief Destructs an Atlas object
+	/// @note Tested
+	Atlas::~Atlas (void)
+	{
+		for (std::list<AtlasPage*>::iterator iter = mPages.begin(); iter != mPages.end(); ++iter) delete *iter;
+	}
+
+	/// @brief Packs an image into the atlas
+	/// @param pPixels Pixels of image, in the atlas's format
+	/// @param w Image width
+	/// @param h Image height
+	/// @param pitch Bytes per row of pixels
+	/// @param x [out] Left edge of image within page
+	/// @param y [out] Top edge of image within page
+	/// @return Page holding the image
+	/// @note Tested
+	AtlasPage * Atlas::Insert (void const * pPixels, GLsizei w, GLsizei h, GLsizei pitch, GLint & x, GLint & y)
+	{
+		assert(pPixels != 0);
+
+		AtlasPage * pPage = Reserve(w, h, x, y);
+
+		// Upload the image into its region of the page.
+		Main::Get().mBackend->UpdateTexture(pPage->mTexture, x, y, w, h, pitch, pPixels);
+
+		return pPage;
+	}
+
+	/// @brief Packs an image into the atlas, surrounded by a copy of its outermost texels
+	/// @param pPixels 32-bit RGBA pixels of image
+	/// @param w Image width
+	/// @param h Image height
+	/// @param pitch Bytes per row of pixels
+	/// @param x [out] Left edge of image within page, inside the border
+	/// @param y [out] Top edge of image within page, inside the border
+	/// @return Page holding the image
+	/// @note Tested
+	AtlasPage * Atlas::InsertExtruded (Uint8 const * pPixels, GLsizei w, GLsizei h, GLsizei pitch, GLint & x, GLint & y)
+	{
+		assert(pPixels != 0);
+
+		AtlasPage * pPage = Reserve(w + 2, h + 2, x, y);
+
+		++x, ++y;
+
+		pPage->UploadExtruded(pPixels, w, h, pitch, x, y);
+
+		return pPage;
+	}
+
+	/// @brief Reserves a region of the atlas
+	/// @param w Width of region
+	/// @param h Height of region
+	/// @param x [out] Left edge of region within page
+	/// @param y [out] Top edge of region within page
+	/// @return Page holding the region
+	/// @note Tested
+	AtlasPage * Atlas::Reserve (GLsizei w, GLsizei h, GLint & x, GLint & y)
+	{
+		// Look for room in an existing page. If there is none, start a new one, big enough
+		// to hold the region if it exceeds the ordinary page size.
+		// Evicted pages are passed over, as they have no texture to upload into.
+		for (std::list<AtlasPage*>::iterator iter = mPages.begin(); iter != mPages.end(); ++iter)
+		{
+			if ((*iter)->mTexture != 0 && (*iter)->Allocate(w, h, x, y)) return *iter;
+		}
+
+		GLsizei size = std::max(mPageSize, Main::Get().mBackend->FitTexture(std::max(w, h)));
+
+		AtlasPage * pPage = new AtlasPage(size, size, mFormat);
+
+		mPages.push_back(pPage);
+
+		pPage->Allocate(w, h, x, y);
+
+		return pPage;
+	}
+
+	/// @brief Releases an image's hold on its page
+	/// @param page Page holding the image
+	/// @note Tested
+	void Atlas::Release (AtlasPage * page)
+	{
+		assert(page != 0);
+		assert(page->mCount > 0);
+
+		// The skyline cannot reclaim single regions, so a page is only recycled once all of
+		// its images are gone.
+		if (--page->mCount != 0) return;
+
+		mPages.remove(page);
+
+		delete page;
+	}
+}
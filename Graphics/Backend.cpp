@@ -0,0 +1,229 @@
+/// @file
+/// Device-independent part of the rendering backends
+
+#include "Graphics_Imp.h"
+#include <cstring>
+#include <iostream>
+
+namespace Graphics
+{
+	/// @brief Constructs a Backend object
+	/// @note Tested
+	Backend::Backend (void) : mBound(c_Unbound), mTarget(0), mNPOT(true), mRetained(false), mTargets(false)
+	{
+		mOrigin[0] = mOrigin[1] = 0;
+
+		memset(&mStats, 0, sizeof(RenderStats));
+		memset(&mLastStats, 0, sizeof(RenderStats));
+	}
+
+	/// @brief Destructs a Backend object
+	/// @note Tested
+	Backend::~Backend (void)
+	{
+	}
+
+	/// @brief Clears the render target within the scissor rectangle
+	/// @note Tested
+	void Backend::Clear (void)
+	{
+		++mStats.mClears;
+
+		DoClear();
+	}
+
+	/// @brief Draws primitives
+	/// @param mode Primitive type
+	/// @param texture Texture used by the primitives, or 0 if untextured
+	/// @param pVerts Vertices of the primitives
+	/// @param count Vertex count
+	/// @param shade Blending of the primitives into the render target
+	/// @note Tested
+	void Backend::Draw (GLenum mode, GLuint texture, Vertex const * pVerts, GLsizei count, Shade shade)
+	{
+		if (texture != mBound)
+		{
+			++mStats.mTextureBinds;
+
+			DoBind(texture);
+
+			mBound = texture;
+		}
+
+		++mStats.mDrawCalls;
+
+		mStats.mVertices += count;
+
+		DoDraw(mode, pVerts, count, shade);
+	}
+
+	/// @brief Presents the completed frame
+	/// @note Tested
+	void Backend::Present (void)
+	{
+		// Write the frame out first if that was requested.
+		if (!mCapture.empty())
+		{
+			if (!Capture(mCapture)) std::cerr << "Unable to save frame: " << mCapture << std::endl;
+
+			mCapture.clear();
+		}
+
+		DoPresent();
+
+		// Keep the frame's statistics and start counting anew.
+		mLastStats = mStats;
+
+		memset(&mStats, 0, sizeof(RenderStats));
+	}
+
+	/// @brief Sets the scissor rectangle
+	/// @param x Left edge, in pixels
+	/// @param y Bottom edge, in pixels
+	/// @param w Width, in pixels
+	/// @param h Height, in pixels
+	/// @note Tested
+	void Backend::Scissor (GLint x, GLint y, GLsizei w, GLsizei h)
+	{
+		++mStats.mScissors;
+
+		DoScissor(x, y, w, h);
+	}
+
+	/// @brief Sets the render target
+	/// @param texture Texture to render into, or 0 for the screen
+	/// @param x Screen position of the target's left edge, in pixels
+	/// @param y Screen position of the target's bottom edge, in pixels
+	/// @param w Width of the target, in pixels
+	/// @param h Height of the target, in pixels
+	/// @note Tested
+	/// @note Primitives keep their screen positions; a texture receives the part of the
+	/// screen it covers, bottom row first. The scissor rectangle must be set anew afterward
+	void Backend::SetTarget (GLuint texture, GLint x, GLint y, GLsizei w, GLsizei h)
+	{
+		++mStats.mTargetSwitches;
+
+		DoSetTarget(texture, x, y, w, h);
+
+		mTarget = texture;
+		mOrigin[0] = x;
+		mOrigin[1] = y;
+	}
+
+	/// @brief Gets the texture size needed to hold a given number of texels
+	/// @param size Texels needed along one side
+	/// @return size, rounded up to a power of 2 if the device requires it
+	/// @note Tested
+	GLsizei Backend::FitTexture (GLsizei size)
+	{
+		return mNPOT ? size : GLsizei(PowerOf2(size));
+	}
+
+	/// @brief Creates an empty texture
+	/// @param w Texture width
+	/// @param h Texture height
+	/// @param format Texel format: GL_RGBA, or GL_ALPHA for coverage colored when drawn
+	/// @return Texture name
+	/// @note Tested
+	GLuint Backend::CreateTexture (GLsizei w, GLsizei h, GLenum format)
+	{
+		++mStats.mTextureUploads;
+
+		// The device may bind the texture to create it.
+		mBound = c_Unbound;
+
+		GLuint texture = DoCreateTexture(w, h, format);
+
+		mFormats[texture] = format;
+
+		return texture;
+	}
+
+	/// @brief Uploads pixels, in the texture's format, into part of a texture
+	/// @param texture Texture name
+	/// @param x Left edge of region
+	/// @param y Top edge of region
+	/// @param w Region width
+	/// @param h Region height
+	/// @param pitch Bytes per row of pixels
+	/// @param pPixels Pixels to upload
+	/// @note Tested
+	void Backend::UpdateTexture (GLuint texture, GLint x, GLint y, GLsizei w, GLsizei h, GLsizei pitch, void const * pPixels)
+	{
+		++mStats.mTextureUploads;
+
+		// The device may bind the texture to update it.
+		mBound = c_Unbound;
+
+		DoUpdateTexture(texture, mFormats[texture], x, y, w, h, pitch, pPixels);
+	}
+
+	/// @brief Deletes a texture
+	/// @param texture Texture name
+	/// @note Tested
+	void Backend::DeleteTexture (GLuint texture)
+	{
+		if (texture == mBound) mBound = c_Unbound;
+
+		mFormats.erase(texture);
+
+		DoDeleteTexture(texture);
+	}
+
+	/// @brief Gets the size of a texel
+	/// @param format Texel format
+	/// @return Bytes per texel
+	/// @note Tested
+	GLsizei Backend::TexelSize (GLenum format)
+	{
+		return GL_ALPHA == format ? 1 : 4;
+	}
+
+	/// @brief Makes the device current on the calling thread, after a Detach
+	/// @return If true, the device may be driven from the calling thread
+	/// @note Tested
+	bool Backend::Attach (void)
+	{
+		return true;
+	}
+
+	/// @brief Writes the frame in progress to a PNG file
+	/// @param name Name of file to write
+	/// @return If true, the backend can read back frames and the file was written
+	/// @note Tested
+	bool Backend::Capture (std::string const & name)
+	{
+		return false;
+	}
+
+	/// @brief Releases the device from the calling thread, so that another may Attach it
+	/// @return If true, the device was released; devices with no thread of their own
+	/// always are
+	/// @note Tested
+	bool Backend::Detach (void)
+	{
+		return true;
+	}
+
+	/// @brief Writes the commands of the last completed frame to a stream
+	/// @param stream Stream to write
+	/// @return If true, the backend keeps commands and they were written
+	/// @note Tested
+	bool Backend::Dump (std::ostream & stream)
+	{
+		return false;
+	}
+
+	/// @brief Makes a backend
+	/// @param name Name of backend: "GL", "Record", or "Software"
+	/// @return New backend, or 0 if the name is unknown
+	/// @note Tested
+	Backend * Backend::Make (std::string const & name)
+	{
+		if ("GL" == name) return new GLBackend;
+		if ("Record" == name) return new RecordBackend;
+		if ("Software" == name) return new SoftwareBackend;
+
+		return 0;
+	}
+}
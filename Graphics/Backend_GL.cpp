@@ -0,0 +1,444 @@
+/// @file
+/// Backend that renders through OpenGL
+
+#include "Graphics_Imp.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace Graphics
+{
+	/// @brief Constructs a GLBackend object
+	/// @note Tested
+	GLBackend::GLBackend (void) : mBindFramebuffer(0), mCheckFramebufferStatus(0), mDeleteFramebuffers(0), mFramebufferTexture2D(0), mGenFramebuffers(0), mBlendFuncSeparate(0), mDC(0), mContext(0)
+	{
+		Invalidate();
+	}
+
+	/// @brief Makes the OpenGL context released by Detach current on the calling thread
+	/// @return If true, the context is current
+	/// @note Tested
+	bool GLBackend::Attach (void)
+	{
+	#ifdef _WIN32
+		return wglMakeCurrent(HDC(mDC), HGLRC(mContext)) != FALSE;
+	#else
+		return true;
+	#endif
+	}
+
+	/// @brief Reads back the frame in progress and writes it to a PNG file
+	/// @param name Name of file to write
+	/// @return If true, the file was written
+	/// @note Tested
+	bool GLBackend::Capture (std::string const & name)
+	{
+		GLint viewport[4];	glGetIntegerv(GL_VIEWPORT, viewport);
+
+		GLsizei w = viewport[2], h = viewport[3];
+
+		std::vector<Uint8> pixels(w * h * 4);
+
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		glReadBuffer(GL_BACK);
+		glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+
+		// OpenGL returns the bottom row first; write from the last row up.
+		return WritePNG(name, &pixels[(h - 1) * w * 4], w, h, -w * 4);
+	}
+
+	/// @brief Releases the OpenGL context from the calling thread
+	/// @return If true, the context was released
+	/// @note Tested
+	/// @note SDL gives no way to move a context between threads; on Windows it is moved
+	/// through WGL, and elsewhere it stays with the thread that set the mode
+	bool GLBackend::Detach (void)
+	{
+	#ifdef _WIN32
+		mDC = wglGetCurrentDC();
+		mContext = wglGetCurrentContext();
+
+		return mContext != 0 && wglMakeCurrent(0, 0) != FALSE;
+	#else
+		return false;
+	#endif
+	}
+
+	/// @brief Sets an OpenGL video mode and readies the render state
+	/// @param width Screen width of mode
+	/// @param height Screen height of mode
+	/// @param bpp Bits per pixel of mode
+	/// @param bFullscreen If true, this is a full-screen video mode
+	/// @return If true, the mode was set
+	/// @note Tested
+	bool GLBackend::Open (int width, int height, int bpp, bool bFullscreen)
+	{
+		// Set some OpenGL configuration properties. Set the requested video mode.
+		SDL_GL_SetAttribute(SDL_GL_RED_SIZE, 8);
+		SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8);
+		SDL_GL_SetAttribute(SDL_GL_BLUE_SIZE, 8);
+		SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 16);
+		SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+
+		Uint32 flags = SDL_OPENGL | (bFullscreen ? SDL_FULLSCREEN : 0);
+
+		if (SDL_SetVideoMode(width, height, bpp, flags) == 0) return false;
+
+		// Textures of any size are allowed from OpenGL 2.0 on, or with the extension.
+		char const * version = reinterpret_cast<char const *>(glGetString(GL_VERSION));
+		char const * extensions = reinterpret_cast<char const *>(glGetString(GL_EXTENSIONS));
+
+		int major = 0, minor = 0;
+
+		if (version != 0) sscanf(version, "%d.%d", &major, &minor);
+
+		mNPOT = major >= 2 || (extensions != 0 && strstr(extensions, "GL_ARB_texture_non_power_of_two") != 0);
+
+		// Textures are rendered into through framebuffer objects, with alpha blended apart
+		// from color so that they hold premultiplied colors; both come from extensions.
+		bool bFBO = extensions != 0 && strstr(extensions, "GL_EXT_framebuffer_object") != 0;
+
+		mBindFramebuffer = bFBO ? reinterpret_cast<PFNGLBINDFRAMEBUFFEREXTPROC>(SDL_GL_GetProcAddress("glBindFramebufferEXT")) : 0;
+		mCheckFramebufferStatus = bFBO ? reinterpret_cast<PFNGLCHECKFRAMEBUFFERSTATUSEXTPROC>(SDL_GL_GetProcAddress("glCheckFramebufferStatusEXT")) : 0;
+		mDeleteFramebuffers = bFBO ? reinterpret_cast<PFNGLDELETEFRAMEBUFFERSEXTPROC>(SDL_GL_GetProcAddress("glDeleteFramebuffersEXT")) : 0;
+		mFramebufferTexture2D = bFBO ? reinterpret_cast<PFNGLFRAMEBUFFERTEXTURE2DEXTPROC>(SDL_GL_GetProcAddress("glFramebufferTexture2DEXT")) : 0;
+		mGenFramebuffers = bFBO ? reinterpret_cast<PFNGLGENFRAMEBUFFERSEXTPROC>(SDL_GL_GetProcAddress("glGenFramebuffersEXT")) : 0;
+
+		if (major > 1 || (1 == major && minor >= 4)) mBlendFuncSeparate = reinterpret_cast<PFNGLBLENDFUNCSEPARATEEXTPROC>(SDL_GL_GetProcAddress("glBlendFuncSeparate"));
+
+		else if (extensions != 0 && strstr(extensions, "GL_EXT_blend_func_separate") != 0) mBlendFuncSeparate = reinterpret_cast<PFNGLBLENDFUNCSEPARATEEXTPROC>(SDL_GL_GetProcAddress("glBlendFuncSeparateEXT"));
+
+		else mBlendFuncSeparate = 0;
+
+		mTargets = mBindFramebuffer != 0 && mCheckFramebufferStatus != 0 && mDeleteFramebuffers != 0 && mFramebufferTexture2D != 0 && mGenFramebuffers != 0 && mBlendFuncSeparate != 0;
+
+		// Set up an orthographic projection.
+		glMatrixMode(GL_PROJECTION);
+		glLoadIdentity();
+
+		glOrtho(0.0, double(width), 0.0, double(height), +1.0, -1.0);
+
+		// The mode comes with a fresh context, so neither the shadow state, the texture
+		// bound for drawing, the framebuffer objects, nor the render target still holds.
+		Invalidate();
+
+		mFramebuffers.clear();
+
+		mBound = c_Unbound;
+		mTarget = 0;
+		mOrigin[0] = mOrigin[1] = 0;
+
+		// Set some nice initial graphical properties. Primitives are submitted from
+		// client-side vertex arrays.
+		glEnable(GL_SCISSOR_TEST);
+
+		SetBlending(true, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+		glAlphaFunc(GL_GEQUAL, 0.5f);
+
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		glEnableClientState(GL_COLOR_ARRAY);
+
+		// Rows of alpha texels need not fill whole words.
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+		return true;
+	}
+
+	/// @brief Binds a texture for drawing
+	/// @param texture Texture name, or 0 to draw untextured
+	/// @note Tested
+	void GLBackend::DoBind (GLuint texture)
+	{
+		SetTexturing(texture != 0);
+
+		if (texture != 0) SetTexture(texture);
+	}
+
+	/// @brief Clears the color buffer
+	/// @note Tested
+	void GLBackend::DoClear (void)
+	{
+		glClear(GL_COLOR_BUFFER_BIT);
+	}
+
+	/// @brief Draws primitives from a vertex array
+	/// @param mode Primitive type
+	/// @param pVerts Vertices of the primitives
+	/// @param count Vertex count
+	/// @param shade Blending of the primitives
+	/// @note Tested
+	void GLBackend::DoDraw (GLenum mode, Vertex const * pVerts, GLsizei count, Shade shade)
+	{
+		// Distance fields are drawn solid wherever the filtered field reaches its midpoint,
+		// and opaque within a texture. Within a texture, alpha builds up as coverage, leaving
+		// the colors premultiplied.
+		GLenum src = ePremultiplied == shade ? GL_ONE : GL_SRC_ALPHA;
+
+		SetAlphaTest(eField == shade);
+		SetThreshold(eField == shade && mTarget != 0);
+		SetBlending(shade != eField, src, GL_ONE_MINUS_SRC_ALPHA, mTarget != 0 ? GL_ONE : src, GL_ONE_MINUS_SRC_ALPHA);
+
+		glVertexPointer(2, GL_FLOAT, sizeof(Vertex), &pVerts->mX);
+		glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), &pVerts->mS);
+		glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), pVerts->mColor);
+		glDrawArrays(mode, 0, count);
+	}
+
+	/// @brief Swaps the back buffer to the screen
+	/// @note Tested
+	void GLBackend::DoPresent (void)
+	{
+		SDL_GL_SwapBuffers();
+	}
+
+	/// @brief Sets the scissor rectangle, relative to the render target
+	/// @note Tested
+	void GLBackend::DoScissor (GLint x, GLint y, GLsizei w, GLsizei h)
+	{
+		GLint rect[4] = { x - mOrigin[0], y - mOrigin[1], w, h };
+
+		if (!Change(!std::equal(rect, rect + 4, mState.mScissor))) return;
+
+		std::copy(rect, rect + 4, mState.mScissor);
+
+		glScissor(rect[0], rect[1], w, h);
+	}
+
+	/// @brief Renders into a texture through its framebuffer object, or into the screen
+	/// @note Tested
+	/// @note If the driver cannot render into the texture, rendering into textures is
+	/// turned off; what is drawn before the target changes again is discarded
+	void GLBackend::DoSetTarget (GLuint texture, GLint x, GLint y, GLsizei w, GLsizei h)
+	{
+		if (0 == mBindFramebuffer) return;
+
+		GLuint framebuffer = 0;
+
+		// Attach the texture to a framebuffer object the first time it is rendered into.
+		if (texture != 0)
+		{
+			std::map<GLuint, GLuint>::iterator iter = mFramebuffers.find(texture);
+
+			if (iter == mFramebuffers.end())
+			{
+				mGenFramebuffers(1, &framebuffer);
+				mBindFramebuffer(GL_FRAMEBUFFER_EXT, framebuffer);
+				mFramebufferTexture2D(GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, texture, 0);
+
+				mFramebuffers[texture] = framebuffer;
+
+				// The incomplete framebuffer object stays bound, so that drawing into it
+				// goes nowhere rather than onto the screen.
+				if (mTargets && mCheckFramebufferStatus(GL_FRAMEBUFFER_EXT) != GL_FRAMEBUFFER_COMPLETE_EXT)
+				{
+					std::cerr << "Unable to render into textures: framebuffer object incomplete" << std::endl;
+
+					mTargets = false;
+				}
+			}
+
+			else framebuffer = iter->second;
+		}
+
+		mBindFramebuffer(GL_FRAMEBUFFER_EXT, framebuffer);
+
+		// Map the target's part of the screen onto the whole target.
+		glViewport(0, 0, w, h);
+		glMatrixMode(GL_PROJECTION);
+		glLoadIdentity();
+
+		glOrtho(double(x), double(x + w), double(y), double(y + h), +1.0, -1.0);
+
+		// Scissor rectangles are kept relative to the target, so the shadow no longer holds.
+		std::fill(mState.mScissor, mState.mScissor + 4, -1);
+	}
+
+	/// @brief Creates an empty texture
+	/// @note Tested
+	GLuint GLBackend::DoCreateTexture (GLsizei w, GLsizei h, GLenum format)
+	{
+		GLuint texture;
+
+		glGenTextures(1, &texture);
+
+		SetTexture(texture);
+
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA == format ? GL_ALPHA8 : GL_RGBA8, w, h, 0, format, GL_UNSIGNED_BYTE, 0);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		return texture;
+	}
+
+	/// @brief Uploads pixels into part of a texture
+	/// @note Tested
+	void GLBackend::DoUpdateTexture (GLuint texture, GLenum format, GLint x, GLint y, GLsizei w, GLsizei h, GLsizei pitch, void const * pPixels)
+	{
+		SetTexture(texture);
+		SetRowLength(pitch / TexelSize(format));
+
+		glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, format, GL_UNSIGNED_BYTE, pPixels);
+	}
+
+	/// @brief Deletes a texture
+	/// @note Tested
+	void GLBackend::DoDeleteTexture (GLuint texture)
+	{
+		glDeleteTextures(1, &texture);
+
+		// Deleting the bound texture reverts the binding to the default texture.
+		if (texture == mState.mTexture) mState.mTexture = 0;
+
+		// Drop the framebuffer object of a texture that was rendered into.
+		std::map<GLuint, GLuint>::iterator iter = mFramebuffers.find(texture);
+
+		if (iter == mFramebuffers.end()) return;
+
+		mDeleteFramebuffers(1, &iter->second);
+
+		mFramebuffers.erase(iter);
+	}
+
+	/// @brief Counts a state change as issued or skipped
+	/// @param bChanged If true, the new state differs from the shadow state
+	/// @return bChanged
+	/// @note Tested
+	bool GLBackend::Change (bool bChanged)
+	{
+		++(bChanged ? mStats.mStateChanges : mStats.mStateSkips);
+
+		return bChanged;
+	}
+
+	/// @brief Marks all shadow state as unknown, so that the next change to each is issued
+	/// @note Tested
+	void GLBackend::Invalidate (void)
+	{
+		mState.mTexture = c_Unbound;
+		mState.mRowLength = -1;
+		std::fill(mState.mBlendFunc, mState.mBlendFunc + 4, GLenum(GL_NONE));
+		mState.mTexturing = mState.mBlending = mState.mAlphaTest = mState.mThreshold = -1;
+
+		std::fill(mState.mScissor, mState.mScissor + 4, -1);
+	}
+
+	/// @brief Enables or disables the alpha test
+	/// @param bEnabled If true, the alpha test is enabled
+	/// @note Tested
+	void GLBackend::SetAlphaTest (bool bEnabled)
+	{
+		if (!Change(mState.mAlphaTest != int(bEnabled))) return;
+
+		if (bEnabled) glEnable(GL_ALPHA_TEST);
+
+		else glDisable(GL_ALPHA_TEST);
+
+		mState.mAlphaTest = bEnabled;
+	}
+
+	/// @brief Enables or disables blending, with the given blend factors
+	/// @param bEnabled If true, blending is enabled
+	/// @param src Source blend factor for color
+	/// @param dst Destination blend factor for color
+	/// @param srcAlpha Source blend factor for alpha
+	/// @param dstAlpha Destination blend factor for alpha
+	/// @note Tested
+	/// @note Factors for alpha that differ from those for color need separate blending
+	void GLBackend::SetBlending (bool bEnabled, GLenum src, GLenum dst, GLenum srcAlpha, GLenum dstAlpha)
+	{
+		if (Change(mState.mBlending != int(bEnabled)))
+		{
+			if (bEnabled) glEnable(GL_BLEND);
+
+			else glDisable(GL_BLEND);
+
+			mState.mBlending = bEnabled;
+		}
+
+		GLenum funcs[4] = { src, dst, srcAlpha, dstAlpha };
+
+		if (Change(!std::equal(funcs, funcs + 4, mState.mBlendFunc)))
+		{
+			if (src == srcAlpha && dst == dstAlpha) glBlendFunc(src, dst);
+
+			else mBlendFuncSeparate(src, dst, srcAlpha, dstAlpha);
+
+			std::copy(funcs, funcs + 4, mState.mBlendFunc);
+		}
+	}
+
+	/// @brief Sets the row length used to unpack texture uploads
+	/// @param length Row length, in pixels
+	/// @note Tested
+	void GLBackend::SetRowLength (GLint length)
+	{
+		if (!Change(mState.mRowLength != length)) return;
+
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, length);
+
+		mState.mRowLength = length;
+	}
+
+	/// @brief Binds a texture to GL_TEXTURE_2D
+	/// @param texture Texture name
+	/// @note Tested
+	void GLBackend::SetTexture (GLuint texture)
+	{
+		if (!Change(mState.mTexture != texture)) return;
+
+		glBindTexture(GL_TEXTURE_2D, texture);
+
+		mState.mTexture = texture;
+	}
+
+	/// @brief Enables or disables texturing
+	/// @param bEnabled If true, texturing is enabled
+	/// @note Tested
+	void GLBackend::SetTexturing (bool bEnabled)
+	{
+		if (!Change(mState.mTexturing != int(bEnabled))) return;
+
+		if (bEnabled) glEnable(GL_TEXTURE_2D);
+
+		else glDisable(GL_TEXTURE_2D);
+
+		mState.mTexturing = bEnabled;
+	}
+
+	/// @brief Turns thresholding of texture alpha on or off: when on, texels at least half
+	/// opaque are drawn opaque in the vertex color, and the rest fail the alpha test
+	/// @param bEnabled If true, texture alpha is thresholded
+	/// @note Tested
+	void GLBackend::SetThreshold (bool bEnabled)
+	{
+		if (!Change(mState.mThreshold != int(bEnabled))) return;
+
+		// Doubling alpha saturates it at the midpoint, so only opaque fragments pass.
+		if (bEnabled)
+		{
+			glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_COMBINE);
+			glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_RGB, GL_REPLACE);
+			glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_RGB, GL_PRIMARY_COLOR);
+			glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_ALPHA, GL_REPLACE);
+			glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_ALPHA, GL_TEXTURE);
+			glTexEnvf(GL_TEXTURE_ENV, GL_ALPHA_SCALE, 2.0f);
+
+			glAlphaFunc(GL_GEQUAL, 1.0f);
+		}
+
+		else
+		{
+			glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+			glTexEnvf(GL_TEXTURE_ENV, GL_ALPHA_SCALE, 1.0f);
+
+			glAlphaFunc(GL_GEQUAL, 0.5f);
+		}
+
+		mState.mThreshold = bEnabled;
+	}
+}
@@ -0,0 +1,199 @@
+/// @file
+/// Backend that records commands in memory instead of rendering them
+
+#include "Graphics_Imp.h"
+#include <algorithm>
+#include <ostream>
+
+namespace Graphics
+{
+	/// @var c_Names
+	/// @brief Names of command kinds, as written in dumps
+	static char const * const c_Names[Command::eTypeCount] = {
+		"bind", "clear", "draw", "present", "scissor", "target",
+		"create", "update", "delete"
+	};
+
+	/// @brief Constructs a RecordBackend object
+	/// @note Tested
+	RecordBackend::RecordBackend (void) : mFrames(0), mNextTexture(1)
+	{
+		mTargets = true;
+
+		std::fill(mTotals, mTotals + Command::eTypeCount, 0);
+	}
+
+	/// @brief Writes the commands of the last completed frame to a stream
+	/// @param stream Stream to write
+	/// @return If true, the commands were written
+	/// @note Tested
+	/// @note Each command is written on its own line as its name followed by its arguments;
+	/// draws also give the screen bounds of their vertices. Lines beginning with # are
+	/// comments, carrying the frame number and the running totals.
+	bool RecordBackend::Dump (std::ostream & stream)
+	{
+		stream << "# frame " << mFrames << ": " << mFrame.size() << " commands" << std::endl;
+
+		for (std::vector<Command>::const_iterator iter = mFrame.begin(); iter != mFrame.end(); ++iter)
+		{
+			stream << c_Names[iter->mType];
+
+			switch (iter->mType)
+			{
+			case Command::eBind:
+			case Command::eDeleteTexture:
+				stream << " " << iter->mTexture;
+				break;
+			case Command::eCreateTexture:
+				stream << " " << iter->mTexture << " " << iter->mArgs[0] << "x" << iter->mArgs[1] << (GL_ALPHA == GLenum(iter->mArgs[2]) ? " alpha" : " rgba");
+				break;
+			case Command::eTarget:
+			case Command::eUpdateTexture:
+				stream << " " << iter->mTexture;
+				// fall through
+			case Command::eScissor:
+				stream << " " << iter->mArgs[0] << " " << iter->mArgs[1] << " " << iter->mArgs[2] << " " << iter->mArgs[3];
+				break;
+			case Command::eDraw:
+				{
+					stream << (GL_QUADS == GLenum(iter->mArgs[0]) ? " quads " : " lines ") << iter->mArgs[2];
+
+					if (eField == iter->mArgs[3]) stream << " field";
+					if (ePremultiplied == iter->mArgs[3]) stream << " premultiplied";
+
+					// Give the bounds of the vertices, which locate the draw on screen.
+					Vertex const * pVerts = &mFrameVertices[iter->mArgs[1]];
+
+					GLfloat fX0 = pVerts->mX, fY0 = pVerts->mY, fX1 = fX0, fY1 = fY0;
+
+					for (GLint index = 1; index < iter->mArgs[2]; ++index)
+					{
+						fX0 = std::min(fX0, pVerts[index].mX);
+						fY0 = std::min(fY0, pVerts[index].mY);
+						fX1 = std::max(fX1, pVerts[index].mX);
+						fY1 = std::max(fY1, pVerts[index].mY);
+					}
+
+					stream << " " << fX0 << " " << fY0 << " " << fX1 << " " << fY1;
+				}
+				break;
+			default:
+				break;
+			}
+
+			stream << std::endl;
+		}
+
+		stream << "#";
+
+		for (int type = 0; type < Command::eTypeCount; ++type) stream << " " << c_Names[type] << "=" << mTotals[type];
+
+		stream << std::endl;
+
+		return true;
+	}
+
+	/// @brief Sets a video mode without OpenGL, e.g. for the SDL dummy video driver
+	/// @param width Screen width of mode
+	/// @param height Screen height of mode
+	/// @param bpp Bits per pixel of mode
+	/// @param bFullscreen If true, this is a full-screen video mode
+	/// @return If true, the mode was set
+	/// @note Tested
+	bool RecordBackend::Open (int width, int height, int bpp, bool bFullscreen)
+	{
+		return SDL_SetVideoMode(width, height, bpp, bFullscreen ? SDL_FULLSCREEN : 0) != 0;
+	}
+
+	/// @brief Records a bind
+	/// @note Tested
+	void RecordBackend::DoBind (GLuint texture)
+	{
+		Add(Command::eBind, texture);
+	}
+
+	/// @brief Records a clear
+	/// @note Tested
+	void RecordBackend::DoClear (void)
+	{
+		Add(Command::eClear, 0);
+	}
+
+	/// @brief Records a draw, keeping its vertices
+	/// @note Tested
+	void RecordBackend::DoDraw (GLenum mode, Vertex const * pVerts, GLsizei count, Shade shade)
+	{
+		Add(Command::eDraw, mBound, mode, GLint(mVertices.size()), count, shade);
+
+		mVertices.insert(mVertices.end(), pVerts, pVerts + count);
+	}
+
+	/// @brief Records a present, and closes out the frame
+	/// @note Tested
+	void RecordBackend::DoPresent (void)
+	{
+		Add(Command::ePresent, 0);
+
+		mFrame.swap(mCommands);
+		mFrameVertices.swap(mVertices);
+
+		mCommands.clear();
+		mVertices.clear();
+
+		++mFrames;
+	}
+
+	/// @brief Records a scissor change
+	/// @note Tested
+	void RecordBackend::DoScissor (GLint x, GLint y, GLsizei w, GLsizei h)
+	{
+		Add(Command::eScissor, 0, x, y, w, h);
+	}
+
+	/// @brief Records a render target change
+	/// @note Tested
+	void RecordBackend::DoSetTarget (GLuint texture, GLint x, GLint y, GLsizei w, GLsizei h)
+	{
+		Add(Command::eTarget, texture, x, y, w, h);
+	}
+
+	/// @brief Records a texture creation
+	/// @note Tested
+	GLuint RecordBackend::DoCreateTexture (GLsizei w, GLsizei h, GLenum format)
+	{
+		Add(Command::eCreateTexture, mNextTexture, w, h, format);
+
+		return mNextTexture++;
+	}
+
+	/// @brief Records a texture update
+	/// @note Tested
+	void RecordBackend::DoUpdateTexture (GLuint texture, GLenum, GLint x, GLint y, GLsizei w, GLsizei h, GLsizei, void const *)
+	{
+		Add(Command::eUpdateTexture, texture, x, y, w, h);
+	}
+
+	/// @brief Records a texture deletion
+	/// @note Tested
+	void RecordBackend::DoDeleteTexture (GLuint texture)
+	{
+		Add(Command::eDeleteTexture, texture);
+	}
+
+	/// @brief Appends a command to the frame in progress
+	/// @param type Kind of command
+	/// @param texture Texture operated on, if any
+	/// @param a0 First argument
+	/// @param a1 Second argument
+	/// @param a2 Third argument
+	/// @param a3 Fourth argument
+	/// @note Tested
+	void RecordBackend::Add (Command::Type type, GLuint texture, GLint a0, GLint a1, GLint a2, GLint a3)
+	{
+		Command command = { type, texture, { a0, a1, a2, a3 } };
+
+		mCommands.push_back(command);
+
+		++mTotals[type];
+	}
+}
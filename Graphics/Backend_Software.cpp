@@ -0,0 +1,456 @@
+/// @file
+/// Backend that rasterizes into an RGBA framebuffer in memory
+
+#include "Graphics_Imp.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Graphics
+{
+	/// @var c_Opaque
+	/// @brief Alpha bits of an RGBA pixel
+	static Uint32 const c_Opaque = c_Amask;
+
+	/// @var c_White
+	/// @brief Opaque white RGBA pixel, i.e. a color that leaves texels unchanged
+	static Uint32 const c_White = 0xFFFFFFFF;
+
+	/// @brief Computes x * y / 255, rounded, for 8-bit channels
+	/// @note Tested
+	static inline Uint32 Scale (Uint32 x)
+	{
+		x += 128;
+
+		return (x + (x >> 8)) >> 8;
+	}
+
+	/// @brief Blends one RGBA pixel over another, as GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA
+	/// @param pDest Destination pixel, updated in place
+	/// @param pSrc Source pixel
+	/// @param pFloor Least source factor of each channel: 0 where it is the source alpha, or
+	/// 255 where it is GL_ONE
+	/// @note Tested
+	static inline void Blend (Uint8 * pDest, Uint8 const * pSrc, Uint8 const * pFloor)
+	{
+		Uint32 a = pSrc[3];
+
+		for (int channel = 0; channel < 4; ++channel) pDest[channel] = Uint8(Scale(pSrc[channel] * std::max(a, Uint32(pFloor[channel])) + pDest[channel] * (255 - a)));
+	}
+
+#ifdef GRAPHICS_SSE2
+	/// @brief Computes x * y / 255, rounded, for eight 16-bit channels
+	/// @note Tested
+	static inline __m128i Scale (__m128i x)
+	{
+		x = _mm_add_epi16(x, _mm_set1_epi16(128));
+
+		return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+	}
+
+	/// @brief Blends two source pixels over two destination pixels, widened to 16 bits
+	/// @note Tested
+	static inline __m128i Blend (__m128i src, __m128i dest, __m128i floor)
+	{
+		__m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+		__m128i inverse = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+
+		return Scale(_mm_add_epi16(_mm_mullo_epi16(src, _mm_max_epi16(alpha, floor)), _mm_mullo_epi16(dest, inverse)));
+	}
+#endif
+
+	/// @brief Blends a span of source pixels over a span of destination pixels
+	/// @param pDest Destination pixels, updated in place
+	/// @param pSrc Source pixels
+	/// @param count Pixel count
+	/// @param floor Least source factor of each channel, as an RGBA pixel
+	/// @note Tested
+	static void BlendSpan (Uint32 * pDest, Uint32 const * pSrc, GLsizei count, Uint32 floor)
+	{
+		GLsizei index = 0;
+
+	#ifdef GRAPHICS_SSE2
+		// Blend four pixels at a time, copying runs that are fully opaque and skipping
+		// runs that are fully transparent.
+		__m128i zero = _mm_setzero_si128();
+		__m128i opaque = _mm_set1_epi32(int(c_Opaque));
+		__m128i factor = _mm_unpacklo_epi8(_mm_set1_epi32(int(floor)), zero);
+
+		for (; index + 4 <= count; index += 4)
+		{
+			__m128i src = _mm_loadu_si128(reinterpret_cast<__m128i const *>(pSrc + index));
+			__m128i alpha = _mm_and_si128(src, opaque);
+
+			if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, opaque)) == 0xFFFF)
+			{
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(pDest + index), src);
+
+				continue;
+			}
+
+			if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, zero)) == 0xFFFF) continue;
+
+			__m128i dest = _mm_loadu_si128(reinterpret_cast<__m128i *>(pDest + index));
+			__m128i lo = Blend(_mm_unpacklo_epi8(src, zero), _mm_unpacklo_epi8(dest, zero), factor);
+			__m128i hi = Blend(_mm_unpackhi_epi8(src, zero), _mm_unpackhi_epi8(dest, zero), factor);
+
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(pDest + index), _mm_packus_epi16(lo, hi));
+		}
+	#endif
+
+		for (; index < count; ++index)
+		{
+			Blend(reinterpret_cast<Uint8 *>(pDest + index), reinterpret_cast<Uint8 const *>(pSrc + index), reinterpret_cast<Uint8 const *>(&floor));
+		}
+	}
+
+	/// @brief Multiplies a span of pixels by a color, channel by channel
+	/// @param pSpan Pixels, updated in place
+	/// @param color RGBA color
+	/// @param count Pixel count
+	/// @note Tested
+	static void ModulateSpan (Uint32 * pSpan, Uint32 color, GLsizei count)
+	{
+		GLsizei index = 0;
+
+	#ifdef GRAPHICS_SSE2
+		__m128i zero = _mm_setzero_si128();
+		__m128i factor = _mm_unpacklo_epi8(_mm_set1_epi32(int(color)), zero);
+
+		for (; index + 4 <= count; index += 4)
+		{
+			__m128i pixels = _mm_loadu_si128(reinterpret_cast<__m128i *>(pSpan + index));
+			__m128i lo = Scale(_mm_mullo_epi16(_mm_unpacklo_epi8(pixels, zero), factor));
+			__m128i hi = Scale(_mm_mullo_epi16(_mm_unpackhi_epi8(pixels, zero), factor));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(pSpan + index), _mm_packus_epi16(lo, hi));
+		}
+	#endif
+
+		Uint8 const * pColor = reinterpret_cast<Uint8 const *>(&color);
+
+		for (; index < count; ++index)
+		{
+			Uint8 * pPixel = reinterpret_cast<Uint8 *>(pSpan + index);
+
+			for (int channel = 0; channel < 4; ++channel) pPixel[channel] = Uint8(Scale(pPixel[channel] * pColor[channel]));
+		}
+	}
+
+	/// @brief Makes a span of distance-field texels opaque where the field reaches its
+	/// midpoint, and transparent elsewhere, as the alpha test does
+	/// @param pSpan Texels, updated in place
+	/// @param count Texel count
+	/// @note Tested
+	static void ThresholdSpan (Uint32 * pSpan, GLsizei count)
+	{
+		for (GLsizei index = 0; index < count; ++index)
+		{
+			pSpan[index] = (pSpan[index] & c_Opaque) >= (c_Opaque & 0x80808080) ? pSpan[index] | c_Opaque : 0;
+		}
+	}
+
+	/// @brief Constructs a SoftwareBackend object
+	/// @note Tested
+	SoftwareBackend::SoftwareBackend (void) : mTexture(0), mLayer(0), mScreen(0), mW(0), mH(0), mNextTexture(1)
+	{
+		mRetained = true;
+		mTargets = true;
+
+		std::fill(mScissor, mScissor + 4, 0);
+		std::fill(mRect, mRect + 4, 0);
+	}
+
+	/// @brief Writes the frame in progress to a PNG file
+	/// @param name Name of file to write
+	/// @return If true, the file was written
+	/// @note Tested
+	bool SoftwareBackend::Capture (std::string const & name)
+	{
+		if (mPixels.empty()) return false;
+
+		return WritePNG(name, reinterpret_cast<Uint8 const *>(&mPixels[0]), mW, mH, mW * 4);
+	}
+
+	/// @brief Keeps the device on the calling thread, since SDL shows frames to the screen
+	/// surface only from the thread that set the video mode
+	/// @return false
+	/// @note Tested
+	bool SoftwareBackend::Detach (void)
+	{
+		return false;
+	}
+
+	/// @brief Sets a video mode without OpenGL and sizes the framebuffer to match
+	/// @param width Screen width of mode
+	/// @param height Screen height of mode
+	/// @param bpp Bits per pixel of mode
+	/// @param bFullscreen If true, this is a full-screen video mode
+	/// @return If true, the mode was set
+	/// @note Tested
+	bool SoftwareBackend::Open (int width, int height, int bpp, bool bFullscreen)
+	{
+		mScreen = SDL_SetVideoMode(width, height, bpp, bFullscreen ? SDL_FULLSCREEN : 0);
+
+		if (0 == mScreen) return false;
+
+		mW = width;
+		mH = height;
+
+		mPixels.assign(width * height, 0);
+		mSpan.resize(width);
+
+		// Render into the whole framebuffer.
+		mTarget = 0;
+		mOrigin[0] = mOrigin[1] = 0;
+
+		DoSetTarget(0, 0, 0, width, height);
+
+		return true;
+	}
+
+	/// @brief Binds a texture for drawing
+	/// @note Tested
+	void SoftwareBackend::DoBind (GLuint texture)
+	{
+		mTexture = texture != 0 ? &mTextures[texture] : 0;
+	}
+
+	/// @brief Clears the framebuffer within the scissor rectangle
+	/// @note Tested
+	void SoftwareBackend::DoClear (void)
+	{
+		if (mScissor[0] >= mScissor[2]) return;
+
+		for (GLint y = mScissor[1]; y < mScissor[3]; ++y)
+		{
+			Uint32 * pRow = Pixel(mScissor[0], y);
+
+			std::fill(pRow, pRow + mScissor[2] - mScissor[0], 0);
+		}
+	}
+
+	/// @brief Rasterizes primitives
+	/// @note Tested
+	void SoftwareBackend::DoDraw (GLenum mode, Vertex const * pVerts, GLsizei count, Shade shade)
+	{
+		if (GL_QUADS == mode)
+		{
+			for (GLsizei index = 0; index + 4 <= count; index += 4) DrawQuad(pVerts + index, shade);
+		}
+
+		else
+		{
+			for (GLsizei index = 0; index + 2 <= count; index += 2) DrawLine(pVerts[index], pVerts[index + 1]);
+		}
+	}
+
+	/// @brief Shows the frame on the screen surface
+	/// @note Tested
+	void SoftwareBackend::DoPresent (void)
+	{
+		if (0 == mScreen || mPixels.empty()) return;
+
+		SDL_Surface * pFrame = SDL_CreateRGBSurfaceFrom(&mPixels[0], mW, mH, 32, mW * 4, c_Rmask, c_Gmask, c_Bmask, c_Amask);
+
+		if (0 == pFrame) return;
+
+		// Copy, rather than blend, the frame onto the screen.
+		SDL_SetAlpha(pFrame, 0, 0);
+		SDL_BlitSurface(pFrame, 0, mScreen, 0);
+		SDL_UpdateRect(mScreen, 0, 0, 0, 0);
+		SDL_FreeSurface(pFrame);
+	}
+
+	/// @brief Sets the scissor rectangle, clipped to the render target
+	/// @note Tested
+	void SoftwareBackend::DoScissor (GLint x, GLint y, GLsizei w, GLsizei h)
+	{
+		mScissor[0] = std::max(x, mRect[0]);
+		mScissor[1] = std::max(y, mRect[1]);
+		mScissor[2] = std::min(x + w, mRect[2]);
+		mScissor[3] = std::min(y + h, mRect[3]);
+	}
+
+	/// @brief Renders into a texture or into the framebuffer
+	/// @note Tested
+	void SoftwareBackend::DoSetTarget (GLuint texture, GLint x, GLint y, GLsizei w, GLsizei h)
+	{
+		mLayer = texture != 0 ? &mTextures[texture] : 0;
+
+		mRect[0] = x;
+		mRect[1] = y;
+		mRect[2] = x + w;
+		mRect[3] = y + h;
+
+		// Drawing is confined to the target until the scissor rectangle is set anew.
+		DoScissor(x, y, w, h);
+	}
+
+	/// @brief Creates an empty RGBA texture
+	/// @note Tested
+	GLuint SoftwareBackend::DoCreateTexture (GLsizei w, GLsizei h, GLenum)
+	{
+		Texture & texture = mTextures[mNextTexture];
+
+		texture.mTexels.assign(w * h, 0);
+		texture.mW = w;
+		texture.mH = h;
+
+		return mNextTexture++;
+	}
+
+	/// @brief Copies pixels into part of a texture, expanding alpha pixels to RGBA
+	/// @note Tested
+	void SoftwareBackend::DoUpdateTexture (GLuint texture, GLenum format, GLint x, GLint y, GLsizei w, GLsizei h, GLsizei pitch, void const * pPixels)
+	{
+		Texture & dest = mTextures[texture];
+
+		Uint8 const * pRow = static_cast<Uint8 const *>(pPixels);
+
+		for (GLsizei row = 0; row < h; ++row, pRow += pitch)
+		{
+			Uint32 * pDest = &dest.mTexels[(y + row) * dest.mW + x];
+
+			if (GL_ALPHA == format) ExpandAlpha(pDest, pRow, w);
+
+			else memcpy(pDest, pRow, w * 4);
+		}
+	}
+
+	/// @brief Deletes a texture
+	/// @note Tested
+	void SoftwareBackend::DoDeleteTexture (GLuint texture)
+	{
+		std::map<GLuint, Texture>::iterator iter = mTextures.find(texture);
+
+		if (iter == mTextures.end()) return;
+
+		if (&iter->second == mTexture) mTexture = 0;
+
+		mTextures.erase(iter);
+	}
+
+	/// @brief Rasterizes an untextured line, leaving off its last pixel as OpenGL does
+	/// @param start Start vertex
+	/// @param end End vertex
+	/// @note Tested
+	void SoftwareBackend::DrawLine (Vertex const & start, Vertex const & end)
+	{
+		GLfloat fDX = end.mX - start.mX, fDY = end.mY - start.mY;
+
+		int steps = int(std::max(fabsf(fDX), fabsf(fDY)));
+
+		if (0 == steps) return;
+
+		// Step one pixel at a time along the major axis.
+		fDX /= steps;
+		fDY /= steps;
+
+		GLfloat fX = start.mX, fY = start.mY;
+
+		Uint32 floor = GetFloor(eBlend);
+
+		for (int step = 0; step < steps; ++step, fX += fDX, fY += fDY)
+		{
+			GLint x = GLint(floorf(fX)), y = GLint(floorf(fY));
+
+			if (x < mScissor[0] || x >= mScissor[2] || y < mScissor[1] || y >= mScissor[3]) continue;
+
+			Blend(reinterpret_cast<Uint8 *>(Pixel(x, y)), start.mColor, reinterpret_cast<Uint8 const *>(&floor));
+		}
+	}
+
+	/// @brief Rasterizes an axis-aligned quad, as built by Batch::AddQuad
+	/// @param pCorners Corners of the quad
+	/// @param shade Blending of the quad
+	/// @note Tested
+	/// @note Texels are sampled nearest-neighbor, clamped to the texture's edges
+	void SoftwareBackend::DrawQuad (Vertex const * pCorners, Shade shade)
+	{
+		GLfloat fX0 = pCorners[0].mX, fX1 = pCorners[2].mX, fS0 = pCorners[0].mS, fS1 = pCorners[2].mS;
+		GLfloat fY0 = pCorners[0].mY, fY1 = pCorners[2].mY, fT0 = pCorners[0].mT, fT1 = pCorners[2].mT;
+
+		if (fX1 < fX0) std::swap(fX0, fX1), std::swap(fS0, fS1);
+		if (fY1 < fY0) std::swap(fY0, fY1), std::swap(fT0, fT1);
+
+		// Find the pixels whose centers the quad covers, within the scissor rectangle.
+		GLint left = std::max(GLint(ceilf(fX0 - 0.5f)), mScissor[0]);
+		GLint right = std::min(GLint(ceilf(fX1 - 0.5f)), mScissor[2]);
+		GLint bottom = std::max(GLint(ceilf(fY0 - 0.5f)), mScissor[1]);
+		GLint top = std::min(GLint(ceilf(fY1 - 0.5f)), mScissor[3]);
+
+		if (left >= right || bottom >= top) return;
+
+		Uint32 color;	memcpy(&color, pCorners[0].mColor, 4);
+
+		GLsizei count = right - left;
+
+		Uint32 floor = GetFloor(shade);
+
+		// Untextured quads fill with their color; opaque ones need no blending.
+		if (0 == mTexture)
+		{
+			std::fill(mSpan.begin(), mSpan.begin() + count, color);
+
+			for (GLint y = bottom; y < top; ++y)
+			{
+				Uint32 * pRow = Pixel(left, y);
+
+				if ((color & c_Opaque) == c_Opaque) std::copy(mSpan.begin(), mSpan.begin() + count, pRow);
+
+				else BlendSpan(pRow, &mSpan[0], count, floor);
+			}
+
+			return;
+		}
+
+		// Sample a row of texels at the pixel centers, tint it, and blend it in.
+		GLfloat fDS = (fS1 - fS0) / (fX1 - fX0), fDT = (fT1 - fT0) / (fY1 - fY0);
+		GLsizei texW = mTexture->mW, texH = mTexture->mH;
+
+		for (GLint y = bottom; y < top; ++y)
+		{
+			GLint ty = GLint(floorf((fT0 + (y + 0.5f - fY0) * fDT) * texH));
+
+			Uint32 const * pTexels = &mTexture->mTexels[std::min(std::max(ty, 0), texH - 1) * texW];
+
+			GLfloat fS = (fS0 + (left + 0.5f - fX0) * fDS) * texW, fStep = fDS * texW;
+
+			for (GLsizei index = 0; index < count; ++index, fS += fStep)
+			{
+				mSpan[index] = pTexels[std::min(std::max(GLint(floorf(fS)), 0), texW - 1)];
+			}
+
+			if (eField == shade) ThresholdSpan(&mSpan[0], count);
+
+			if (color != c_White) ModulateSpan(&mSpan[0], color, count);
+
+			BlendSpan(Pixel(left, y), &mSpan[0], count, floor);
+		}
+	}
+
+	/// @brief Gets the least source factor of each channel when blending
+	/// @param shade Blending of the primitives
+	/// @return Factors, as an RGBA pixel
+	/// @note Tested
+	/// @note Within a texture, alpha builds up as coverage, leaving the colors premultiplied
+	Uint32 SoftwareBackend::GetFloor (Shade shade) const
+	{
+		if (ePremultiplied == shade) return c_White;
+
+		return mLayer != 0 ? c_Opaque : 0;
+	}
+
+	/// @brief Gets a pixel of the render target
+	/// @param x Screen x coordinate, in pixels
+	/// @param y Screen y coordinate, in pixels, measured up
+	/// @return Pixel, followed by the rest of its row
+	/// @note Tested
+	Uint32 * SoftwareBackend::Pixel (GLint x, GLint y)
+	{
+		if (0 == mLayer) return &mPixels[(mH - 1 - y) * mW + x];
+
+		return &mLayer->mTexels[(y - mRect[1]) * mLayer->mW + x - mRect[0]];
+	}
+}
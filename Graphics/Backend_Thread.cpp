@@ -0,0 +1,352 @@
+/// @file
+/// Backend that queues device commands for a render thread
+
+#include "Graphics_Imp.h"
+
+namespace Graphics
+{
+	/// @brief Constructs a ThreadedBackend object
+	/// @param device Backend carrying out the commands; the new object owns it
+	/// @note Tested
+	ThreadedBackend::ThreadedBackend (Backend * device) : mDevice(device), mThread(0), mNextTexture(1), mFilling(0), mRunning(false)
+	{
+		mReady = SDL_CreateSemaphore(0);
+		mDone = SDL_CreateSemaphore(1);
+	}
+
+	/// @brief Destructs a ThreadedBackend object, carrying out any commands still queued
+	/// @note Tested
+	ThreadedBackend::~ThreadedBackend (void)
+	{
+		Stop();
+		Play(mFrames[mFilling]);
+
+		delete mDevice;
+
+		SDL_DestroySemaphore(mReady);
+		SDL_DestroySemaphore(mDone);
+	}
+
+	/// @brief Requests that the frame in progress be written to a PNG file when carried out
+	/// @param name Name of file to write
+	/// @return true; failures are reported when the frame is carried out
+	/// @note Tested
+	bool ThreadedBackend::Capture (std::string const & name)
+	{
+		mFrames[mFilling].mCapture = name;
+
+		return true;
+	}
+
+	/// @brief Writes the commands of the last frame carried out, if the device keeps them
+	/// @param stream Stream to write
+	/// @return If true, the device keeps commands and they were written
+	/// @note Tested
+	bool ThreadedBackend::Dump (std::ostream & stream)
+	{
+		Finish();
+
+		return mDevice->Dump(stream);
+	}
+
+	/// @brief Sets a video mode through the device, and starts the render thread if the
+	/// device can be driven from it
+	/// @param width Screen width of mode
+	/// @param height Screen height of mode
+	/// @param bpp Bits per pixel of mode
+	/// @param bFullscreen If true, this is a full-screen video mode
+	/// @return If true, the mode was set
+	/// @note Tested
+	bool ThreadedBackend::Open (int width, int height, int bpp, bool bFullscreen)
+	{
+		// Carry out everything queued so far, with the device back on this thread.
+		Stop();
+		Play(mFrames[mFilling]);
+
+		if (!mDevice->Open(width, height, bpp, bFullscreen)) return false;
+
+		mNPOT = mDevice->mNPOT;
+		mRetained = mDevice->mRetained;
+		mTargets = mDevice->mTargets;
+
+		// Hand the device to the render thread, and wait for it to take hold of it; if it
+		// cannot, frames are carried out on this thread instead.
+		if (!mDevice->Detach()) return true;
+
+		mRunning = true;
+
+		SDL_SemWait(mDone);
+
+		mThread = SDL_CreateThread(Render, this);
+
+		if (mThread != 0) SDL_SemWait(mDone);
+
+		if (!mRunning || 0 == mThread)
+		{
+			if (mThread != 0) SDL_WaitThread(mThread, 0);
+
+			mThread = 0;
+			mRunning = false;
+
+			mDevice->Attach();
+		}
+
+		SDL_SemPost(mDone);
+
+		return true;
+	}
+
+	/// @brief Carries out everything queued so far and gives up the device, so that it may
+	/// be driven directly
+	/// @return Device, now owned by the caller
+	/// @note Tested
+	/// @note The device's texture names differ from those handed out, so this is only
+	/// done before any textures are created
+	Backend * ThreadedBackend::Release (void)
+	{
+		Stop();
+		Play(mFrames[mFilling]);
+
+		Backend * device = mDevice;
+
+		mDevice = 0;
+
+		return device;
+	}
+
+	/// @brief Does nothing, the device binding textures as it draws
+	/// @note Tested
+	void ThreadedBackend::DoBind (GLuint)
+	{
+	}
+
+	/// @brief Queues a clear
+	/// @note Tested
+	void ThreadedBackend::DoClear (void)
+	{
+		Add(Command::eClear, 0);
+	}
+
+	/// @brief Queues a draw, copying its vertices
+	/// @note Tested
+	void ThreadedBackend::DoDraw (GLenum mode, Vertex const * pVerts, GLsizei count, Shade shade)
+	{
+		Frame & frame = mFrames[mFilling];
+
+		Add(Command::eDraw, mBound, mode, GLint(frame.mVertices.size()), count, shade);
+
+		frame.mVertices.insert(frame.mVertices.end(), pVerts, pVerts + count);
+	}
+
+	/// @brief Closes out the frame, and hands it to the render thread once that has carried
+	/// out the last one
+	/// @note Tested
+	/// @note Device state changes are counted on the render thread, so they are reported
+	/// a frame late
+	void ThreadedBackend::DoPresent (void)
+	{
+		Add(Command::ePresent, 0);
+
+		if (0 == mThread) Play(mFrames[mFilling]);
+
+		else SDL_SemWait(mDone);
+
+		// The device is idle here, so its figures may be read, and any loss of rendering
+		// into textures taken up.
+		mStats.mStateChanges += mDevice->mLastStats.mStateChanges;
+		mStats.mStateSkips += mDevice->mLastStats.mStateSkips;
+
+		mTargets = mTargets && mDevice->mTargets;
+
+		if (mThread != 0)
+		{
+			mFilling ^= 1;
+
+			SDL_SemPost(mReady);
+		}
+	}
+
+	/// @brief Queues a scissor change
+	/// @note Tested
+	void ThreadedBackend::DoScissor (GLint x, GLint y, GLsizei w, GLsizei h)
+	{
+		Add(Command::eScissor, 0, x, y, w, h);
+	}
+
+	/// @brief Queues a render target change
+	/// @note Tested
+	void ThreadedBackend::DoSetTarget (GLuint texture, GLint x, GLint y, GLsizei w, GLsizei h)
+	{
+		Add(Command::eTarget, texture, x, y, w, h);
+	}
+
+	/// @brief Hands out a texture name at once, queuing the texture's creation
+	/// @note Tested
+	GLuint ThreadedBackend::DoCreateTexture (GLsizei w, GLsizei h, GLenum format)
+	{
+		Add(Command::eCreateTexture, mNextTexture, w, h, format);
+
+		return mNextTexture++;
+	}
+
+	/// @brief Queues a texture update, copying its pixels
+	/// @note Tested
+	void ThreadedBackend::DoUpdateTexture (GLuint texture, GLenum format, GLint x, GLint y, GLsizei w, GLsizei h, GLsizei pitch, void const * pPixels)
+	{
+		Frame & frame = mFrames[mFilling];
+
+		Add(Command::eUpdateTexture, texture, x, y, w, h);
+
+		GLsizei row = w * TexelSize(format);
+
+		for (GLsizei index = 0; index < h; ++index)
+		{
+			Uint8 const * pRow = static_cast<Uint8 const *>(pPixels) + index * pitch;
+
+			frame.mPixels.insert(frame.mPixels.end(), pRow, pRow + row);
+		}
+	}
+
+	/// @brief Queues a texture deletion
+	/// @note Tested
+	void ThreadedBackend::DoDeleteTexture (GLuint texture)
+	{
+		Add(Command::eDeleteTexture, texture);
+	}
+
+	/// @brief Appends a command to the frame being filled
+	/// @param type Kind of command
+	/// @param texture Texture operated on, if any
+	/// @param a0 First argument
+	/// @param a1 Second argument
+	/// @param a2 Third argument
+	/// @param a3 Fourth argument
+	/// @note Tested
+	void ThreadedBackend::Add (Command::Type type, GLuint texture, GLint a0, GLint a1, GLint a2, GLint a3)
+	{
+		Command command = { type, texture, { a0, a1, a2, a3 } };
+
+		mFrames[mFilling].mCommands.push_back(command);
+	}
+
+	/// @brief Waits until the render thread has carried out every frame handed to it
+	/// @note Tested
+	void ThreadedBackend::Finish (void)
+	{
+		if (0 == mThread) return;
+
+		SDL_SemWait(mDone);
+		SDL_SemPost(mDone);
+	}
+
+	/// @brief Carries out a frame's commands on the device, and empties the frame
+	/// @param frame Frame to carry out
+	/// @note Tested
+	void ThreadedBackend::Play (Frame & frame)
+	{
+		std::vector<Uint8>::size_type offset = 0;
+
+		for (std::vector<Command>::const_iterator iter = frame.mCommands.begin(); iter != frame.mCommands.end(); ++iter)
+		{
+			GLint const * args = iter->mArgs;
+
+			// Texture 0 stands for the screen, or for untextured drawing.
+			GLuint texture = iter->mTexture != 0 ? mNames[iter->mTexture] : 0;
+
+			switch (iter->mType)
+			{
+			case Command::eClear:
+				mDevice->Clear();
+				break;
+			case Command::eDraw:
+				mDevice->Draw(GLenum(args[0]), texture, &frame.mVertices[args[1]], args[2], Shade(args[3]));
+				break;
+			case Command::ePresent:
+				mDevice->mCapture = frame.mCapture;
+				mDevice->Present();
+				break;
+			case Command::eScissor:
+				mDevice->Scissor(args[0], args[1], args[2], args[3]);
+				break;
+			case Command::eTarget:
+				mDevice->SetTarget(texture, args[0], args[1], args[2], args[3]);
+				break;
+			case Command::eCreateTexture:
+				mNames[iter->mTexture] = mDevice->CreateTexture(args[0], args[1], GLenum(args[2]));
+				break;
+			case Command::eUpdateTexture:
+				{
+					GLsizei row = args[2] * TexelSize(mDevice->mFormats[texture]);
+
+					mDevice->UpdateTexture(texture, args[0], args[1], args[2], args[3], row, &frame.mPixels[offset]);
+
+					offset += row * args[3];
+				}
+				break;
+			case Command::eDeleteTexture:
+				mDevice->DeleteTexture(texture);
+
+				mNames.erase(iter->mTexture);
+				break;
+			default:
+				break;
+			}
+		}
+
+		frame.mCommands.clear();
+		frame.mVertices.clear();
+		frame.mPixels.clear();
+		frame.mCapture.clear();
+	}
+
+	/// @brief Waits for the render thread to go idle, and stops it, taking the device back
+	/// onto the calling thread
+	/// @note Tested
+	void ThreadedBackend::Stop (void)
+	{
+		if (0 == mThread) return;
+
+		Finish();
+
+		mRunning = false;
+
+		SDL_SemPost(mReady);
+		SDL_WaitThread(mThread, 0);
+
+		mThread = 0;
+
+		mDevice->Attach();
+	}
+
+	/// @brief Render thread: carries out each frame handed to it
+	/// @param pData Backend driven
+	/// @return 0
+	/// @note Tested
+	int ThreadedBackend::Render (void * pData)
+	{
+		ThreadedBackend * pBackend = static_cast<ThreadedBackend*>(pData);
+
+		// Take hold of the device, and report whether that worked.
+		pBackend->mRunning = pBackend->mDevice->Attach();
+
+		SDL_SemPost(pBackend->mDone);
+
+		if (!pBackend->mRunning) return 0;
+
+		for (;;)
+		{
+			SDL_SemWait(pBackend->mReady);
+
+			if (!pBackend->mRunning) break;
+
+			// The frame filled before the last hand-off is the one not being filled now.
+			pBackend->Play(pBackend->mFrames[pBackend->mFilling ^ 1]);
+
+			SDL_SemPost(pBackend->mDone);
+		}
+
+		pBackend->mDevice->Detach();
+
+		return 0;
+	}
+}
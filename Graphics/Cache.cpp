@@ -0,0 +1,357 @@
+/// @file
+/// Mapped files, and the on-disk cache of decoded images
+
+#include "Graphics_Imp.h"
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+	#include <windows.h>
+	#include <direct.h>
+#else
+	#include <sys/mman.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+namespace Graphics
+{
+	/// @var c_CacheMagic
+	/// @brief Tag opening every cached image, "UICI" in file order
+	static Uint32 const c_CacheMagic = 0x49434955;
+	/// @var c_CacheVersion
+	/// @brief Layout version of cached images; older entries are rebuilt
+	static Uint32 const c_CacheVersion = 1;
+
+	/// @brief Header of a cached image, followed by the source name and then the pixels
+	struct CacheHeader {
+		Uint32 mMagic;	///< c_CacheMagic
+		Uint32 mVersion;///< c_CacheVersion
+		Uint32 mSize;	///< Size of source file when decoded
+		Uint32 mTime;	///< Modification time of source file when decoded
+		Uint32 mW;	///< Image width
+		Uint32 mH;	///< Image height
+		Uint32 mNameLength;	///< Length of source name following the header
+		Uint32 mOffset;	///< Offset of RGBA pixels, tightly packed, from the start of the file
+	};
+
+	/// @brief Gets the name of the cache entry for an image file
+	/// @param name Name of image file
+	/// @return Name of entry within the cache directory
+	/// @note Tested
+	static std::string EntryName (std::string const & name)
+	{
+		// Hash the name with 32-bit FNV-1a; entries record their full source name, so a
+		// collision only costs a decode.
+		Uint32 hash = 2166136261u;
+
+		for (std::string::size_type index = 0; index < name.size(); ++index) hash = (hash ^ Uint8(name[index])) * 16777619u;
+
+		char entry[16];
+
+		sprintf(entry, "%08x.rgba", hash);
+
+		return Main::Get().mImageCache + "/" + entry;
+	}
+
+	/// @brief Fills in the fields of a cache header describing an image file as it stands
+	/// @param name Name of image file
+	/// @param entry Entry of the file in the asset pack, or 0 if it is read from disk
+	/// @param header [out] On success, header with the source fields filled in
+	/// @return If true, the file was found
+	/// @note Tested
+	/// @note Files in the pack take the pack's modification time
+	static bool Describe (std::string const & name, PackEntry const * entry, CacheHeader & header)
+	{
+		struct stat info;
+
+		if (0 == entry && stat(name.c_str(), &info) != 0) return false;
+
+		memset(&header, 0, sizeof(CacheHeader));
+
+		header.mMagic = c_CacheMagic;
+		header.mVersion = c_CacheVersion;
+		header.mSize = entry != 0 ? entry->mSize : Uint32(info.st_size);
+		header.mTime = entry != 0 ? Main::Get().mPack.mTime : Uint32(info.st_mtime);
+		header.mNameLength = Uint32(name.size());
+		header.mOffset = (sizeof(CacheHeader) + header.mNameLength + 15) & ~15;
+
+		return true;
+	}
+
+	/// @brief Constructs a MappedFile object
+	/// @note Tested
+	MappedFile::MappedFile (void) : mData(0), mSize(0), mHandle(0)
+	{
+	}
+
+	/// @brief Destructs a MappedFile object
+	/// @note Tested
+	MappedFile::~MappedFile (void)
+	{
+		Close();
+	}
+
+	/// @brief Maps a file into memory, replacing any current mapping
+	/// @param name Name of file to map
+	/// @return If true, the file was mapped
+	/// @note Tested
+	bool MappedFile::Open (std::string const & name)
+	{
+		Close();
+
+	#ifdef _WIN32
+		HANDLE file = CreateFileA(name.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+
+		if (INVALID_HANDLE_VALUE == file) return false;
+
+		DWORD size = GetFileSize(file, 0);
+
+		// The mapping keeps the file open on its own.
+		HANDLE mapping = size != 0 && size != INVALID_FILE_SIZE ? CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0) : 0;
+
+		CloseHandle(file);
+
+		if (0 == mapping) return false;
+
+		void * pView = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+		if (0 == pView)
+		{
+			CloseHandle(mapping);
+
+			return false;
+		}
+
+		mHandle = mapping;
+	#else
+		int file = open(name.c_str(), O_RDONLY);
+
+		if (file < 0) return false;
+
+		struct stat info;
+
+		void * pView = fstat(file, &info) == 0 && info.st_size > 0 ? mmap(0, size_t(info.st_size), PROT_READ, MAP_SHARED, file, 0) : MAP_FAILED;
+
+		// The mapping keeps the file open on its own.
+		close(file);
+
+		if (MAP_FAILED == pView) return false;
+
+		size_t size = size_t(info.st_size);
+	#endif
+
+		mData = static_cast<Uint8 const *>(pView);
+		mSize = size;
+
+		return true;
+	}
+
+	/// @brief Unmaps the file, if one is mapped
+	/// @note Tested
+	void MappedFile::Close (void)
+	{
+		if (0 == mData) return;
+
+	#ifdef _WIN32
+		UnmapViewOfFile(mData);
+		CloseHandle(mHandle);
+	#else
+		munmap(const_cast<Uint8 *>(mData), mSize);
+	#endif
+
+		mData = 0;
+		mSize = 0;
+		mHandle = 0;
+	}
+
+	/// @brief Constructs an ImageData object
+	/// @note Tested
+	ImageData::ImageData (void) : mSurface(0), mPixels(0), mW(0), mH(0), mPitch(0)
+	{
+	}
+
+	/// @brief Destructs an ImageData object
+	/// @note Tested
+	ImageData::~ImageData (void)
+	{
+		if (mSurface != 0) SDL_FreeSurface(mSurface);
+	}
+
+	/// @brief Loads an image file's pixels, from the cache if it holds an up-to-date entry,
+	/// or else by decoding the file and then adding it to the cache
+	/// @param name Name of image file
+	/// @return If true, the pixels were loaded
+	/// @note Tested
+	/// @note The file is read from the asset pack if the pack holds it, and from disk if not
+	bool ImageData::Load (std::string const & name)
+	{
+		Main & g = Main::Get();
+
+		PackEntry const * pEntry = g.mPack.Find(name);
+
+		CacheHeader header;
+
+		bool bCache = !g.mImageCache.empty() && Describe(name, pEntry, header);
+
+		// Use the cached pixels as they are, if the entry is for this file as it stands.
+		if (bCache && mFile.Open(EntryName(name)) && mFile.mSize >= header.mOffset)
+		{
+			CacheHeader const * pEntry = reinterpret_cast<CacheHeader const *>(mFile.mData);
+
+			header.mW = pEntry->mW;
+			header.mH = pEntry->mH;
+
+			if (0 == memcmp(pEntry, &header, sizeof(CacheHeader)) && 0 == name.compare(0, name.size(), reinterpret_cast<char const *>(pEntry + 1), pEntry->mNameLength) && mFile.mSize >= header.mOffset + size_t(header.mW) * header.mH * 4)
+			{
+				mW = GLsizei(header.mW);
+				mH = GLsizei(header.mH);
+				mPitch = mW * 4;
+				mPixels = mFile.mData + header.mOffset;
+
+				return true;
+			}
+		}
+
+		mFile.Close();
+
+		// Decode the image, getting it in RGBA form.
+		if (pEntry != 0)
+		{
+			SDL_RWops * pData = SDL_RWFromConstMem(g.mPack.GetData(pEntry), int(pEntry->mSize));
+
+			mSurface = pData != 0 ? IMG_Load_RW(pData, 1) : 0;
+		}
+
+		else mSurface = IMG_Load(name.c_str());
+
+		if (0 == mSurface) return false;
+
+		mPixels = GetRGBA(mSurface, mScratch, mPitch);
+
+		if (0 == mPixels) return false;
+
+		mW = mSurface->w;
+		mH = mSurface->h;
+
+		if (!bCache) return true;
+
+		// Write the entry under a temporary name and move it into place, so that a partly
+		// written entry is never mapped. The name is the decoding thread's own, as loads of
+		// the same file, e.g. of a thumbnail and of the full image, may be in flight at once.
+		char suffix[16];
+
+		sprintf(suffix, ".%08x.tmp", unsigned(SDL_ThreadID()));
+
+		std::string entry = EntryName(name), temp = entry + suffix;
+
+		header.mW = Uint32(mW);
+		header.mH = Uint32(mH);
+
+		std::ofstream file(temp.c_str(), std::ios::binary);
+
+		file.write(reinterpret_cast<char const *>(&header), sizeof(CacheHeader));
+		file.write(name.data(), std::streamsize(name.size()));
+
+		for (size_t pad = sizeof(CacheHeader) + name.size(); pad < header.mOffset; ++pad) file.put('\0');
+
+		for (GLsizei y = 0; y < mH; ++y) file.write(reinterpret_cast<char const *>(mPixels + y * mPitch), std::streamsize(mW * 4));
+
+		file.close();
+
+		remove(entry.c_str());
+
+		// Another thread may have moved its copy into place in between; that one serves.
+		if (!file || rename(temp.c_str(), entry.c_str()) != 0)
+		{
+			struct stat info;
+
+			if (!file || stat(entry.c_str(), &info) != 0) std::cerr << "Unable to cache image: " << name << std::endl;
+
+			remove(temp.c_str());
+		}
+
+		return true;
+	}
+
+	/// @brief Builds the image's mip chain down to a given size, keeping only its last level
+	/// @param size The pixels are halved while their larger side is at least twice this
+	/// @note Tested
+	void ImageData::Reduce (GLsizei size)
+	{
+		if (std::max(mW, mH) < 2 * size) return;
+
+		while (std::max(mW, mH) >= 2 * size)
+		{
+			std::vector<Uint32> level(((mW + 1) / 2) * ((mH + 1) / 2));
+
+			HalveRGBA(&level[0], mPixels, mW, mH, mPitch);
+
+			mScratch.swap(level);
+
+			mW = (mW + 1) / 2;
+			mH = (mH + 1) / 2;
+			mPitch = mW * 4;
+			mPixels = reinterpret_cast<Uint8 const *>(&mScratch[0]);
+		}
+
+		// Let go of the full-size pixels.
+		if (mSurface != 0) SDL_FreeSurface(mSurface);
+
+		mSurface = 0;
+
+		mFile.Close();
+	}
+
+	/// @brief Makes the cache directory if it is missing
+	/// @param dir Name of directory
+	/// @return If true, the directory exists
+	/// @note Tested
+	bool MakeCacheDir (std::string const & dir)
+	{
+	#ifdef _WIN32
+		_mkdir(dir.c_str());
+	#else
+		mkdir(dir.c_str(), 0777);
+	#endif
+
+		struct stat info;
+
+		return 0 == stat(dir.c_str(), &info) && (info.st_mode & S_IFDIR) != 0;
+	}
+
+	/// @brief Gets the canonical path of a file, the same for every name reaching it
+	/// @param name Name of file
+	/// @return Absolute path of file, or empty if it is not found
+	/// @note Tested
+	std::string CanonicalPath (std::string const & name)
+	{
+	#ifdef _WIN32
+		char path[_MAX_PATH];
+
+		if (0 == _fullpath(path, name.c_str(), _MAX_PATH)) return "";
+
+		// Names on Windows differ only up to case and separators.
+		std::string canonical = path;
+
+		std::replace(canonical.begin(), canonical.end(), '/', '\\');
+		std::transform(canonical.begin(), canonical.end(), canonical.begin(), tolower);
+
+		struct stat info;
+
+		return 0 == stat(canonical.c_str(), &info) ? canonical : "";
+	#else
+		char path[PATH_MAX];
+
+		return realpath(name.c_str(), path) != 0 ? path : "";
+	#endif
+	}
+}
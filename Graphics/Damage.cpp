@@ -0,0 +1,285 @@
+/// @file
+/// Damage tracking: calls made to the screen are put off until the frame is drawn, and
+/// matched against those of the last frame, so that only what changed is repainted
+
+#include "Graphics_Imp.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Graphics
+{
+	/// @var c_DamageRects
+	/// @brief Most rectangles repainted in a frame; beyond this, rectangles are merged
+	static size_t const c_DamageRects = 4;
+
+	/// @brief Mixes bytes into a 32-bit FNV-1a hash
+	/// @param hash Hash so far
+	/// @param pData Bytes to mix in
+	/// @param size Count of bytes
+	/// @return Updated hash
+	/// @note Tested
+	static Uint32 Mix (Uint32 hash, void const * pData, size_t size)
+	{
+		Uint8 const * pBytes = static_cast<Uint8 const *>(pData);
+
+		for (size_t index = 0; index < size; ++index) hash = (hash ^ pBytes[index]) * 16777619u;
+
+		return hash;
+	}
+
+	/// @brief Mixes into a hash whether a picture's image is placed in the atlas
+	/// @param hash Hash so far
+	/// @param Pic Picture, or 0 if none
+	/// @return Updated hash
+	/// @note Tested
+	static Uint32 MixPlaced (Uint32 hash, Picture * Pic)
+	{
+		bool bPlaced = Pic != 0 && Pic->mImage->IsPlaced();
+
+		return Mix(hash, &bPlaced, sizeof(bPlaced));
+	}
+
+	/// @brief Gets the pixels covered by a rectangle in normalized screen coordinates
+	/// @param fX Screen x coordinate, in [0, 1]
+	/// @param fY Screen y coordinate, in [0, 1]
+	/// @param fW Screen width, in [0, 1]
+	/// @param fH Screen height, in [0, 1]
+	/// @param slack Pixels added on every side
+	/// @return Rectangle, in pixels
+	/// @note Tested
+	static Rect ScreenRect (float fX, float fY, float fW, float fH, GLint slack)
+	{
+		Main & g = Main::Get();
+
+		Rect rect;
+
+		rect.mX0 = GLint(floorf(fX * g.mResW)) - slack;
+		rect.mY0 = GLint(floorf((1.0f - fY - fH) * g.mResH)) - slack;
+		rect.mX1 = GLint(ceilf((fX + fW) * g.mResW)) + slack;
+		rect.mY1 = GLint(ceilf((1.0f - fY) * g.mResH)) + slack;
+
+		return rect;
+	}
+
+	/// @brief Gets the smallest rectangle holding two others
+	/// @param a First rectangle
+	/// @param b Second rectangle
+	/// @return Rectangle holding both
+	/// @note Tested
+	static Rect Union (Rect const & a, Rect const & b)
+	{
+		Rect rect = { std::min(a.mX0, b.mX0), std::min(a.mY0, b.mY0), std::max(a.mX1, b.mX1), std::max(a.mY1, b.mY1) };
+
+		return rect;
+	}
+
+	/// @brief Gets the area of a rectangle
+	/// @param rect Rectangle
+	/// @return Area, in pixels, or 0 if the rectangle is empty
+	/// @note Tested
+	static Uint32 Area (Rect const & rect)
+	{
+		if (rect.mX0 >= rect.mX1 || rect.mY0 >= rect.mY1) return 0;
+
+		return Uint32(rect.mX1 - rect.mX0) * Uint32(rect.mY1 - rect.mY0);
+	}
+
+	/// @brief Adds a screen rectangle to those repainted when the frame is drawn
+	/// @param rect Rectangle, in pixels
+	/// @note Tested
+	/// @note Overlapping rectangles are merged, and past a few, so is the pair costing the
+	/// least extra area, so that no pixel is repainted twice
+	void Main::AddDamage (Rect rect)
+	{
+		rect.mX0 = std::max(rect.mX0, GLint(0));
+		rect.mY0 = std::max(rect.mY0, GLint(0));
+		rect.mX1 = std::min(rect.mX1, GLint(mResW));
+		rect.mY1 = std::min(rect.mY1, GLint(mResH));
+
+		if (0 == Area(rect)) return;
+
+		for (std::vector<Rect>::iterator iter = mDamage.begin(); iter != mDamage.end(); ++iter)
+		{
+			if (rect.mX0 < iter->mX1 && iter->mX0 < rect.mX1 && rect.mY0 < iter->mY1 && iter->mY0 < rect.mY1)
+			{
+				Rect merged = Union(rect, *iter);
+
+				mDamage.erase(iter);
+
+				AddDamage(merged);
+
+				return;
+			}
+		}
+
+		if (mDamage.size() < c_DamageRects)
+		{
+			mDamage.push_back(rect);
+
+			return;
+		}
+
+		std::vector<Rect>::iterator best = mDamage.begin();
+
+		for (std::vector<Rect>::iterator iter = mDamage.begin(); iter != mDamage.end(); ++iter)
+		{
+			if (Area(Union(rect, *iter)) - Area(*iter) < Area(Union(rect, *best)) - Area(*best)) best = iter;
+		}
+
+		Rect merged = Union(rect, *best);
+
+		mDamage.erase(best);
+
+		AddDamage(merged);
+	}
+
+	/// @brief Puts off a call made to the screen until the frame is drawn, noting what it
+	/// may touch
+	/// @param command Call made
+	/// @note Tested
+	/// @note Bounds calls are only kept, to be replayed; their effect shows up in the clip
+	/// of the draw calls that follow
+	void Main::Defer (BlockCommand const & command)
+	{
+		mCalls.push_back(command);
+
+		if (BlockCommand::ePopBounds == command.mType || BlockCommand::ePushBounds == command.mType || BlockCommand::eSetBounds == command.mType) return;
+
+		float const * args = command.mArgs;
+
+		// Key the call by everything passed to it and by the clip it is drawn under. A layer
+		// rendered anew this frame has changed even if the call has not, as has a picture
+		// whose image was placed since the last frame.
+		Uint32 hash = 2166136261u;
+
+		hash = Mix(hash, mBatch.mClip, sizeof(mBatch.mClip));
+		hash = Mix(hash, &command.mType, sizeof(command.mType));
+		hash = Mix(hash, &command.mHandle, sizeof(command.mHandle));
+		hash = Mix(hash, command.mArgs, sizeof(command.mArgs));
+		hash = Mix(hash, command.mFlags, sizeof(command.mFlags));
+		hash = Mix(hash, command.mText.data(), command.mText.size());
+
+		Layer * pLayer = BlockCommand::eLayer == command.mType ? mLayers.Get(command.mHandle) : 0;
+
+		if (pLayer != 0 && pLayer->mRendered == mFrame) hash = Mix(hash, &mFrame, sizeof(mFrame));
+
+		if (BlockCommand::ePicture == command.mType) hash = MixPlaced(hash, mPictures.Get(command.mHandle));
+
+		NineSlice * pSlice = BlockCommand::eNineSlice == command.mType ? mNineSlices.Get(command.mHandle) : 0;
+
+		for (int index = 0; pSlice != 0 && index < 9; ++index) hash = MixPlaced(hash, mPictures.Get(pSlice->mCells[index].mPicture));
+
+		// Find the pixels the call may touch.
+		Rect rect = { 0, 0, 0, 0 };
+
+		switch (command.mType)
+		{
+		case BlockCommand::eBox:
+		case BlockCommand::eGrid:
+			rect = ScreenRect(args[0], args[1], args[2], args[3], 1);
+			break;
+		case BlockCommand::eLayer:
+			if (pLayer != 0)
+			{
+				rect.mX0 = pLayer->mX + GLint(floorf(args[0] * mResW + 0.5f));
+				rect.mY0 = pLayer->mY - GLint(floorf(args[1] * mResH + 0.5f));
+				rect.mX1 = rect.mX0 + pLayer->mW;
+				rect.mY1 = rect.mY0 + pLayer->mH;
+			}
+			break;
+		case BlockCommand::eLine:
+			rect = ScreenRect(std::min(args[0], args[2]), std::min(args[1], args[3]), fabsf(args[2] - args[0]), fabsf(args[3] - args[1]), 1);
+			break;
+		case BlockCommand::eNineSlice:
+		case BlockCommand::ePicture:
+		case BlockCommand::eTextImage:
+			rect = ScreenRect(args[0], args[1], args[2], args[3], 0);
+			break;
+		case BlockCommand::eText:
+			{
+				Font * pFont = mFonts.Get(command.mHandle);
+
+				if (0 == pFont) break;
+
+				// Allow a line's height of slack, as when text is culled.
+				FT_Pos pen = 0;
+
+				for (std::string::size_type index = 0; index < command.mText.size(); ++index) pen += pFont->GetAdvance(static_cast<Uint8>(command.mText[index]));
+
+				GLint height = GLint(Ceiling(pFont->mSize->metrics.height) / 64);
+				GLint left = GLint(floorf(args[0] * mResW + 0.5f));
+				GLint base = GLint(floorf((1.0f - args[1]) * mResH + 0.5f)) - GLint(Ceiling(pFont->mSize->metrics.ascender) / 64);
+
+				rect.mX0 = left - height;
+				rect.mY0 = base - height;
+				rect.mX1 = left + GLint(pen / 64) + height;
+				rect.mY1 = base + 2 * height;
+			}
+			break;
+		default:
+			break;
+		}
+
+		// Drawing stays within the bounds.
+		rect.mX0 = std::max(rect.mX0, GLint(floorf(mBatch.mClip[0])));
+		rect.mY0 = std::max(rect.mY0, GLint(floorf(mBatch.mClip[1])));
+		rect.mX1 = std::min(rect.mX1, GLint(ceilf(mBatch.mClip[2])));
+		rect.mY1 = std::min(rect.mY1, GLint(ceilf(mBatch.mClip[3])));
+
+		// Pair the call with the draw call before it, so that calls reordered have changed.
+		FrameCall call;
+
+		call.mHash = hash;
+		call.mKey = hash ^ (mFrameCalls.empty() ? 0 : mFrameCalls.back().mHash * 2654435761u);
+		call.mRect = rect;
+
+		mFrameCalls.push_back(call);
+	}
+
+	/// @brief Indicates whether calls made now are put off until the frame is drawn
+	/// @return If true, calls are deferred
+	/// @note Tested
+	/// @note Only calls made to the screen are deferred; layers are rendered as usual
+	bool Main::Deferring (void) const
+	{
+		return mDeferring && mTargets.empty();
+	}
+
+	/// @brief Finds the screen rectangles to repaint, from the calls made in this frame
+	/// that were not made in the last, and those made in the last that were not made now
+	/// @note Tested
+	void Main::FindDamage (void)
+	{
+		mDamage.clear();
+
+		std::sort(mFrameCalls.begin(), mFrameCalls.end());
+
+		if (mRepaintAll)
+		{
+			Rect screen = { 0, 0, GLint(mResW), GLint(mResH) };
+
+			AddDamage(screen);
+		}
+
+		// Match calls by key, both lists being sorted.
+		else
+		{
+			std::vector<FrameCall>::const_iterator now = mFrameCalls.begin(), last = mLastCalls.begin();
+
+			while (now != mFrameCalls.end() || last != mLastCalls.end())
+			{
+				if (last == mLastCalls.end() || (now != mFrameCalls.end() && now->mKey < last->mKey)) AddDamage((now++)->mRect);
+
+				else if (now == mFrameCalls.end() || last->mKey < now->mKey) AddDamage((last++)->mRect);
+
+				else ++now, ++last;
+			}
+		}
+
+		// Keep this frame's calls to compare against the next.
+		mLastCalls.swap(mFrameCalls);
+		mFrameCalls.clear();
+
+		mRepaintAll = false;
+	}
+}
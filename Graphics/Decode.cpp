@@ -0,0 +1,321 @@
+/// @file
+/// Asynchronous image loads: files are decoded on worker threads, and their pixels placed
+/// in the atlas a few at a time as frames are prepared
+
+#include "Graphics_Imp.h"
+#include <algorithm>
+#include <iostream>
+
+namespace Graphics
+{
+	/// @var c_DecodeThreads
+	/// @brief Count of threads decoding images
+	static size_t const c_DecodeThreads = 3;
+	/// @var c_UploadBudget
+	/// @brief Bytes of decoded pixels placed in the atlas per frame; at least one image is
+	/// placed each frame, however large
+	static Uint32 const c_UploadBudget = 4 * 1024 * 1024;
+
+	/// @brief Constructs a DecodeJob object
+	/// @param image Image awaiting the pixels
+	/// @note Tested
+	DecodeJob::DecodeJob (Image * image) : mData(new ImageData), mName(image->mName), mImage(image), mThumbnail(image->mThumbnail), mLoaded(false)
+	{
+	}
+
+	/// @brief Destructs a DecodeJob object
+	/// @note Tested
+	DecodeJob::~DecodeJob (void)
+	{
+		delete mData;
+	}
+
+	/// @brief Decodes the image file, or maps it from the cache, and reduces it if it is
+	/// for a thumbnail
+	/// @note Tested
+	void DecodeJob::Run (void)
+	{
+		mLoaded = mData->Load(mName);
+
+		if (mLoaded && mThumbnail != 0) mData->Reduce(mThumbnail);
+	}
+
+	/// @brief Constructs a Decoder object
+	/// @note Tested
+	Decoder::Decoder (void) : mLock(0), mWork(0), mNotify(0), mBusy(0), mRunning(false)
+	{
+	}
+
+	/// @brief Destructs a Decoder object
+	/// @note Tested
+	Decoder::~Decoder (void)
+	{
+		Stop();
+
+		if (mLock != 0) SDL_DestroyMutex(mLock);
+		if (mWork != 0) SDL_DestroySemaphore(mWork);
+	}
+
+	/// @brief Queues a job, starting the worker threads if they are not running
+	/// @param job Job to queue
+	/// @return If true, the job was queued
+	/// @note Tested
+	bool Decoder::Add (DecodeJob * job)
+	{
+		if (!mRunning)
+		{
+			if (0 == mLock) mLock = SDL_CreateMutex();
+			if (0 == mWork) mWork = SDL_CreateSemaphore(0);
+
+			if (0 == mLock || 0 == mWork) return false;
+
+			mRunning = true;
+
+			for (size_t index = 0; index < c_DecodeThreads; ++index)
+			{
+				SDL_Thread * pThread = SDL_CreateThread(Worker, this);
+
+				if (pThread != 0) mThreads.push_back(pThread);
+			}
+
+			if (mThreads.empty())
+			{
+				mRunning = false;
+
+				return false;
+			}
+		}
+
+		SDL_mutexP(mLock);
+
+		mQueue.push_back(job);
+
+		SDL_mutexV(mLock);
+
+		SDL_SemPost(mWork);
+
+		return true;
+	}
+
+	/// @brief Abandons a job, e.g. when its image is unloaded
+	/// @param job Job to abandon
+	/// @note Tested
+	/// @note A job still queued is deleted at once; otherwise it is deleted once decoded
+	void Decoder::Cancel (DecodeJob * job)
+	{
+		SDL_mutexP(mLock);
+
+		std::list<DecodeJob*>::iterator iter = std::find(mQueue.begin(), mQueue.end(), job);
+
+		if (iter != mQueue.end())
+		{
+			mQueue.erase(iter);
+
+			delete job;
+		}
+
+		else job->mImage = 0;
+
+		SDL_mutexV(mLock);
+	}
+
+	/// @brief Counts the jobs not yet placed
+	/// @param decoding [out] Count of jobs queued or being decoded
+	/// @param ready [out] Count of jobs decoded and awaiting placement
+	/// @note Tested
+	void Decoder::Count (Uint32 & decoding, Uint32 & ready)
+	{
+		decoding = ready = 0;
+
+		if (0 == mLock) return;
+
+		SDL_mutexP(mLock);
+
+		decoding = Uint32(mQueue.size()) + mBusy;
+
+		for (std::list<DecodeJob*>::const_iterator iter = mDone.begin(); iter != mDone.end(); ++iter)
+		{
+			if ((*iter)->mImage != 0) ++ready;
+		}
+
+		SDL_mutexV(mLock);
+	}
+
+	/// @brief Takes the next decoded job, deleting any that were abandoned
+	/// @return Job, or 0 if none is ready
+	/// @note Tested
+	DecodeJob * Decoder::Next (void)
+	{
+		if (0 == mLock) return 0;
+
+		DecodeJob * job = 0;
+
+		SDL_mutexP(mLock);
+
+		while (0 == job && !mDone.empty())
+		{
+			job = mDone.front();
+
+			mDone.pop_front();
+
+			if (0 == job->mImage)
+			{
+				delete job;
+
+				job = 0;
+			}
+		}
+
+		SDL_mutexV(mLock);
+
+		return job;
+	}
+
+	/// @brief Stops the worker threads once they finish their current jobs, and deletes any
+	/// jobs left over
+	/// @note Tested
+	void Decoder::Stop (void)
+	{
+		if (mRunning)
+		{
+			SDL_mutexP(mLock);
+
+			mRunning = false;
+
+			SDL_mutexV(mLock);
+
+			for (size_t index = 0; index < mThreads.size(); ++index) SDL_SemPost(mWork);
+			for (size_t index = 0; index < mThreads.size(); ++index) SDL_WaitThread(mThreads[index], 0);
+
+			mThreads.clear();
+		}
+
+		for (std::list<DecodeJob*>::iterator iter = mQueue.begin(); iter != mQueue.end(); ++iter) delete *iter;
+		for (std::list<DecodeJob*>::iterator iter = mDone.begin(); iter != mDone.end(); ++iter) delete *iter;
+
+		mQueue.clear();
+		mDone.clear();
+	}
+
+	/// @brief Waits until a job is decoded, decoding it on the calling thread if no worker
+	/// has taken it yet, and takes it
+	/// @param job Job to wait on
+	/// @note Tested
+	void Decoder::Wait (DecodeJob * job)
+	{
+		SDL_mutexP(mLock);
+
+		std::list<DecodeJob*>::iterator iter = std::find(mQueue.begin(), mQueue.end(), job);
+
+		bool bQueued = iter != mQueue.end();
+
+		if (bQueued) mQueue.erase(iter);
+
+		SDL_mutexV(mLock);
+
+		if (bQueued) job->Run();
+
+		// A worker is decoding the image; poll until it has finished.
+		else for (bool bDone = false; !bDone; )
+		{
+			SDL_mutexP(mLock);
+
+			iter = std::find(mDone.begin(), mDone.end(), job);
+
+			bDone = iter != mDone.end();
+
+			if (bDone) mDone.erase(iter);
+
+			SDL_mutexV(mLock);
+
+			if (!bDone) SDL_Delay(1);
+		}
+	}
+
+	/// @brief Worker thread: decodes queued jobs until stopped
+	/// @param pData Decoder served
+	/// @return 0
+	/// @note Tested
+	int Decoder::Worker (void * pData)
+	{
+		Decoder * pDecoder = static_cast<Decoder*>(pData);
+
+		for (;;)
+		{
+			SDL_SemWait(pDecoder->mWork);
+
+			SDL_mutexP(pDecoder->mLock);
+
+			if (!pDecoder->mRunning)
+			{
+				SDL_mutexV(pDecoder->mLock);
+
+				return 0;
+			}
+
+			// The job may have been waited on, or abandoned, since it was queued.
+			DecodeJob * job = 0;
+
+			if (!pDecoder->mQueue.empty())
+			{
+				job = pDecoder->mQueue.front();
+
+				pDecoder->mQueue.pop_front();
+
+				++pDecoder->mBusy;
+			}
+
+			SDL_mutexV(pDecoder->mLock);
+
+			if (0 == job) continue;
+
+			job->Run();
+
+			SDL_mutexP(pDecoder->mLock);
+
+			pDecoder->mDone.push_back(job);
+
+			--pDecoder->mBusy;
+
+			void (*notify)(void) = pDecoder->mNotify;
+
+			SDL_mutexV(pDecoder->mLock);
+
+			// Let the application know that a frame is due to place the image.
+			if (notify != 0) notify();
+		}
+	}
+
+	/// @brief Places decoded images in the atlas, until the frame's upload budget is spent
+	/// @note Tested
+	/// @note Layers that left out pictures still loading are rendered anew on their next
+	/// draw; on the screen, only the pictures of the images placed are repainted
+	void Main::Stream (void)
+	{
+		Uint32 bytes = 0;
+
+		for (DecodeJob * job; bytes < c_UploadBudget && (job = mDecoder.Next()) != 0; delete job)
+		{
+			Image * pImage = job->mImage;
+
+			pImage->mJob = 0;
+
+			if (!job->mLoaded)
+			{
+				std::cerr << "Unable to load image: " << pImage->mName << std::endl;
+
+				continue;
+			}
+
+			pImage->Place(job->mData);
+
+			job->mData = 0;
+
+			// Tiled images upload nothing until drawn.
+			if (pImage->mPage != 0) bytes += Uint32(pImage->mW * pImage->mH * 4);
+
+			++mPlaced;
+			++mBackend->mStats.mImagesPlaced;
+		}
+	}
+}
@@ -1,8 +1,390 @@
 #include "Graphics_Imp.h"
 #include "Graphics.h"
+#include <algorithm>
+#include <cassert>
 #include <cmath>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 
+/// @var c_White
+/// @brief Color used to draw unmodulated textures
+static GLubyte const c_White[4] = { 0xFF, 0xFF, 0xFF, 0xFF };
+
+/// @var c_MaxThumbnail
+/// @brief Largest thumbnail size; thumbnails stay small enough to pack into the atlas
+static int const c_MaxThumbnail = 256;
+
+/// @brief Packs a color into the form used by batched vertices
+/// @param fR Red value, in [0, 1]
+/// @param fG Green value, in [0, 1]
+/// @param fB Blue value, in [0, 1]
+/// @param color [out] Packed RGBA color
+/// @note Tested
+static void PackColor (float fR, float fG, float fB, GLubyte * color)
+{
+	color[0] = GLubyte(fR * 255.0f + 0.5f);
+	color[1] = GLubyte(fG * 255.0f + 0.5f);
+	color[2] = GLubyte(fB * 255.0f + 0.5f);
+	color[3] = 0xFF;
+}
+
+/// @brief Adds the outline of a box to a batch of lines
+/// @param batch Batch to which lines are added
+/// @param fSX Start x coordinate, in pixels
+/// @param fSY Start y coordinate, in pixels
+/// @param fEX End x coordinate, in pixels
+/// @param fEY End y coordinate, in pixels
+/// @param color RGBA color of box
+/// @note Tested
+static void AddBox (Graphics::Batch & batch, float fSX, float fSY, float fEX, float fEY, GLubyte const * color)
+{
+	batch.AddLine(fSX, fSY, fEX, fSY, color);
+	batch.AddLine(fEX, fSY, fEX, fEY, color);
+	batch.AddLine(fEX, fEY, fSX, fEY, color);
+	batch.AddLine(fSX, fEY, fSX, fSY, color);
+}
+
+/// @brief Batches the tiles of a tiled picture that lie within the bounds
+/// @param g Graphics manager
+/// @param Pic Picture to batch
+/// @param fSX Start x coordinate, in pixels
+/// @param fSY Start y coordinate, in pixels
+/// @param fEX End x coordinate, in pixels
+/// @param fEY End y coordinate, in pixels
+/// @param bFlipH If true, the picture is flipped horizontally
+/// @param bFlipV If true, the picture is flipped vertically
+/// @param bDraw If false, the resident tiles that would be drawn are only marked as used
+/// @note Tested
+static void AddTiles (Graphics::Main & g, Graphics::Picture * Pic, float fSX, float fSY, float fEX, float fEY, bool bFlipH, bool bFlipV, bool bDraw)
+{
+	Graphics::Image * pImage = Pic->mImage;
+
+	// Find the image pixels shown at the start and end of the quad. The top of the image
+	// is drawn at the end y coordinate.
+	float fX0 = Pic->mS0 * pImage->mW, fX1 = Pic->mS1 * pImage->mW;
+	float fY0 = Pic->mT0 * pImage->mH, fY1 = Pic->mT1 * pImage->mH;
+
+	if (bFlipH) std::swap(fX0, fX1);
+	if (bFlipV) std::swap(fY0, fY1);
+
+	if (fX0 == fX1 || fY0 == fY1) return;
+
+	float fScaleX = (fEX - fSX) / (fX1 - fX0), fScaleY = (fEY - fSY) / (fY1 - fY0);
+
+	// Visit the tiles overlapping the pixels shown.
+	GLsizei columns = (pImage->mW + Graphics::c_TileSpan - 1) / Graphics::c_TileSpan;
+	GLsizei rows = (pImage->mH + Graphics::c_TileSpan - 1) / Graphics::c_TileSpan;
+
+	GLint c0 = std::max(GLint(floorf(std::min(fX0, fX1) / Graphics::c_TileSpan)), GLint(0)), c1 = std::min(GLint(ceilf(std::max(fX0, fX1) / Graphics::c_TileSpan)), GLint(columns));
+	GLint r0 = std::max(GLint(floorf(std::min(fY0, fY1) / Graphics::c_TileSpan)), GLint(0)), r1 = std::min(GLint(ceilf(std::max(fY0, fY1) / Graphics::c_TileSpan)), GLint(rows));
+
+	for (GLint row = r0; row < r1; ++row)
+	{
+		for (GLint column = c0; column < c1; ++column)
+		{
+			// Clip the tile to the pixels shown, and find where that lands on the screen.
+			float fL = float(column * Graphics::c_TileSpan), fR = std::min(fL + Graphics::c_TileSpan, float(pImage->mW));
+			float fT = float(row * Graphics::c_TileSpan), fB = std::min(fT + Graphics::c_TileSpan, float(pImage->mH));
+
+			float fA = std::max(fL, std::min(fX0, fX1)), fC = std::min(fR, std::max(fX0, fX1));
+			float fD = std::max(fT, std::min(fY0, fY1)), fE = std::min(fB, std::max(fY0, fY1));
+
+			if (fA >= fC || fD >= fE) continue;
+
+			float fQX0 = fSX + (fA - fX0) * fScaleX, fQX1 = fSX + (fC - fX0) * fScaleX;
+			float fQY0 = fEY - (fE - fY0) * fScaleY, fQY1 = fEY - (fD - fY0) * fScaleY;
+
+			// Texels run from the tile's border, one pixel before its left and top edges.
+			GLfloat fS0 = (fA - fL + 1.0f) / Graphics::c_TileSize, fS1 = (fC - fL + 1.0f) / Graphics::c_TileSize;
+			GLfloat fT0 = (fE - fT + 1.0f) / Graphics::c_TileSize, fT1 = (fD - fT + 1.0f) / Graphics::c_TileSize;
+
+			if (fQX0 > fQX1) std::swap(fQX0, fQX1), std::swap(fS0, fS1);
+			if (fQY0 > fQY1) std::swap(fQY0, fQY1), std::swap(fT0, fT1);
+
+			Uint32 index = Uint32(row * columns + column);
+
+			if (!bDraw)
+			{
+				Graphics::Image::Tile & tile = pImage->mTiles[index];
+
+				if (tile.mTexture != 0 && g.mBatch.InClip(fQX0, fQY0, fQX1, fQY1)) tile.mUsed = g.mFrame;
+
+				continue;
+			}
+
+			if (g.mBatch.CullQuads(fQX0, fQY0, fQX1, fQY1, 1)) continue;
+
+			g.Use(pImage, index);
+			g.mBatch.Prepare(pImage->mTiles[index].mTexture, GL_QUADS);
+			g.mBatch.AddQuad(fQX0, fQY0, fQX1, fQY1, fS0, fT0, fS1, fT1, c_White);
+
+			++g.mBackend->mStats.mTilesDrawn;
+		}
+	}
+}
+
+/// @brief Batches a picture
+/// @param g Graphics manager
+/// @param Pic Picture to batch
+/// @param fX Screen x coordinate, in [0, 1]
+/// @param fY Screen y coordinate, in [0, 1]
+/// @param fW Screen width, in [0, 1]
+/// @param fH Screen height, in [0, 1]
+/// @param bFlipH If true, the picture is flipped horizontally
+/// @param bFlipV If true, the picture is flipped vertically
+/// @param bDraw If false, the resident textures that would be drawn are only marked as in
+/// use, as for calls put off until the frame is drawn: the screen still shows them, even
+/// where it is not repainted, so they are kept from eviction
+/// @note Tested
+static void AddPicture (Graphics::Main & g, Graphics::Picture * Pic, float fX, float fY, float fW, float fH, bool bFlipH, bool bFlipV, bool bDraw = true)
+{
+	// Transform the provided coordinates and dimensions into a form OpenGL expects, and
+	// scale them to the current resolution.
+	float fSX = fX;
+	float fEX = fX + fW;
+	float fSY = 1.0f - fY - fH;
+	float fEY = 1.0f - fY;
+
+	fSX *= g.mResW;
+	fEX *= g.mResW;
+	fSY *= g.mResH;
+	fEY *= g.mResH;
+
+	// For a call put off, only mark the textures on screen as in use.
+	if (!bDraw)
+	{
+		if (!Pic->mImage->IsPlaced() || !g.mBatch.InClip(fSX, fSY, fEX, fEY)) return;
+
+		if (Pic->mImage->mSource != 0) AddTiles(g, Pic, fSX, fSY, fEX, fEY, bFlipH, bFlipV, false);
+
+		else if (Pic->mImage->mPage->mTexture != 0) Pic->mImage->mPage->mUsed = g.mFrame;
+
+		return;
+	}
+
+	// Skip pictures outside the bounds, leaving evicted pages alone.
+	if (g.mBatch.CullQuads(fSX, fSY, fEX, fEY, 1)) return;
+
+	// Leave out pictures whose images are still loading, noting so in any layers being
+	// rendered, so that they are rendered anew once the images arrive.
+	if (!Pic->mImage->IsPlaced())
+	{
+		for (std::vector<Graphics::Layer*>::iterator iter = g.mTargets.begin(); iter != g.mTargets.end(); ++iter) (*iter)->mMissing = true;
+
+		return;
+	}
+
+	if (Pic->mImage->mSource != 0)
+	{
+		AddTiles(g, Pic, fSX, fSY, fEX, fEY, bFlipH, bFlipV, true);
+
+		return;
+	}
+
+	// Batch a quad with the requested properties, using the atlas page holding the
+	// picture's image and the picture's texels mapped into that page.
+	GLfloat fS0, fT0, fS1, fT1;	Pic->GetAtlasTexels(fS0, fT0, fS1, fT1);
+
+	if (bFlipH) std::swap(fS0, fS1);
+	if (bFlipV) std::swap(fT0, fT1);
+
+	g.Use(Pic->mImage->mPage);
+	g.mBatch.Prepare(Pic->mImage->mPage->mTexture, GL_QUADS);
+	g.mBatch.AddQuad(fSX, fSY, fEX, fEY, fS0, fT1, fS1, fT0, c_White);
+}
+
+/// @brief Records a draw call into the block being recorded, if any, and puts it off until
+/// the frame is drawn if damage is being tracked
+/// @param g Graphics manager
+/// @param type Call made
+/// @param handle Handle to the object drawn, if any
+/// @param fX Screen x coordinate, in [0, 1]
+/// @param fY Screen y coordinate, in [0, 1]
+/// @param fW Screen width, or end x coordinate of a line, in [0, 1]
+/// @param fH Screen height, or end y coordinate of a line, in [0, 1]
+/// @param fR Red value, in [0, 1], or in [0, 255] for text
+/// @param fG Green value, in [0, 1], or in [0, 255] for text
+/// @param fB Blue value, in [0, 1], or in [0, 255] for text
+/// @param flag0 Horizontal flip, horizontal cut count, or skipping of empty cells
+/// @param flag1 Vertical flip, or vertical cut count
+/// @param text Text drawn, if any
+/// @note Tested
+static void Record (Graphics::Main & g, Graphics::BlockCommand::Type type, void * handle, float fX = 0.0f, float fY = 0.0f, float fW = 0.0f, float fH = 0.0f, float fR = 0.0f, float fG = 0.0f, float fB = 0.0f, Uint32 flag0 = 0, Uint32 flag1 = 0, char const * text = 0)
+{
+	if (0 == g.mRecording && !g.Deferring()) return;
+
+	Graphics::BlockCommand command;
+
+	float const args[7] = { fX, fY, fW, fH, fR, fG, fB };
+
+	command.mType = type;
+	command.mHandle = handle;
+	command.mFlags[0] = flag0;
+	command.mFlags[1] = flag1;
+
+	std::copy(args, args + 7, command.mArgs);
+
+	if (text != 0) command.mText = text;
+
+	if (g.mRecording != 0) g.mRecording->mCommands.push_back(command);
+
+	if (g.Deferring()) g.Defer(command);
+}
+
+/// @brief Replays recorded calls
+/// @param commands Calls to replay, in order
+/// @param fX Screen x offset, in [-1, 1], added to every recorded position
+/// @param fY Screen y offset, in [-1, 1], added to every recorded position
+/// @note Tested
+static void Replay (std::vector<Graphics::BlockCommand> const & commands, float fX, float fY)
+{
+	for (std::vector<Graphics::BlockCommand>::const_iterator iter = commands.begin(); iter != commands.end(); ++iter)
+	{
+		float const * args = iter->mArgs;
+		float x = args[0] + fX, y = args[1] + fY;
+
+		switch (iter->mType)
+		{
+		case Graphics::BlockCommand::eBox:
+			DrawBox(x, y, args[2], args[3], args[4], args[5], args[6]);
+			break;
+		case Graphics::BlockCommand::eGrid:
+			DrawGrid(x, y, args[2], args[3], args[4], args[5], args[6], iter->mFlags[0], iter->mFlags[1]);
+			break;
+		case Graphics::BlockCommand::eLayer:
+			DrawLayer(iter->mHandle, x, y);
+			break;
+		case Graphics::BlockCommand::eLine:
+			DrawLine(x, y, args[2] + fX, args[3] + fY, args[4], args[5], args[6]);
+			break;
+		case Graphics::BlockCommand::eNineSlice:
+			DrawNineSlice(iter->mHandle, x, y, args[2], args[3], iter->mFlags[0] != 0);
+			break;
+		case Graphics::BlockCommand::ePicture:
+			DrawPictureEx(iter->mHandle, x, y, args[2], args[3], iter->mFlags[0] != 0, iter->mFlags[1] != 0);
+			break;
+		case Graphics::BlockCommand::ePopBounds:
+			PopBounds();
+			break;
+		case Graphics::BlockCommand::ePushBounds:
+			PushBounds(x, y, args[2], args[3]);
+			break;
+		case Graphics::BlockCommand::eSetBounds:
+			SetBounds(x, y, args[2], args[3]);
+			break;
+		case Graphics::BlockCommand::eText:
+			{
+				SDL_Color color = { Uint8(args[4]), Uint8(args[5]), Uint8(args[6]), 0 };
+
+				DrawText(iter->mHandle, iter->mText.c_str(), x, y, color);
+			}
+			break;
+		case Graphics::BlockCommand::eTextImage:
+			DrawTextImage(iter->mHandle, x, y, args[2], args[3]);
+			break;
+		}
+	}
+}
+
+/// @brief Puts off an unload until the calls put off in this frame are carried out
+/// @param g Graphics manager
+/// @param func Unload function
+/// @param handle Handle to unload
+/// @return Non-0, for success
+/// @note Tested
+static int PutOff (Graphics::Main & g, int (*func)(void *), void * handle)
+{
+	g.mUnloads.push_back(std::make_pair(func, handle));
+
+	return 1;
+}
+
+/// @brief Starts over from bounds covering the whole screen
+/// @param g Graphics manager
+/// @note Tested
+static void ResetBounds (Graphics::Main & g)
+{
+	g.mBounds.resize(1);
+
+	g.mBounds.back().mX = g.mBounds.back().mY = 0.0f;
+	g.mBounds.back().mW = g.mBounds.back().mH = 1.0f;
+
+	g.ApplyBounds();
+}
+
+/// @brief Carries out the calls put off in this frame, within the rectangles that changed
+/// since the last frame, and then any unloads put off
+/// @param g Graphics manager
+/// @note Tested
+static void Repaint (Graphics::Main & g)
+{
+	g.mDeferring = false;
+
+	g.FindDamage();
+
+	// A backend that does not keep the screen between frames has it kept in a layer.
+	if (g.mCanvas != 0)
+	{
+		g.mTargets.push_back(g.mCanvas);
+
+		g.ApplyTarget();
+	}
+
+	// Calls are replayed as made, so keep them out of any block.
+	Graphics::Block * pRecording = g.mRecording;
+
+	g.mRecording = 0;
+
+	for (std::vector<Graphics::Rect>::const_iterator iter = g.mDamage.begin(); iter != g.mDamage.end(); ++iter)
+	{
+		g.mRepaint = *iter;
+
+		ResetBounds(g);
+
+		g.mBackend->Clear();
+
+		Replay(g.mCalls, 0.0f, 0.0f);
+
+		g.mBatch.Flush();
+
+		g.mBackend->mStats.mDamagedPixels += Uint32(iter->mX1 - iter->mX0) * Uint32(iter->mY1 - iter->mY0);
+	}
+
+	g.mRecording = pRecording;
+
+	g.mRepaint.mX0 = g.mRepaint.mY0 = 0;
+	g.mRepaint.mX1 = g.mResW;
+	g.mRepaint.mY1 = g.mResH;
+
+	// Copy the layer onto the screen.
+	if (g.mCanvas != 0)
+	{
+		g.mTargets.pop_back();
+
+		g.ApplyTarget();
+
+		ResetBounds(g);
+
+		g.mBackend->Clear();
+
+		Graphics::Layer * pCanvas = g.mCanvas;
+
+		g.mBatch.Prepare(pCanvas->mTexture, GL_QUADS, Graphics::ePremultiplied);
+		g.mBatch.AddQuad(0.0f, 0.0f, GLfloat(pCanvas->mW), GLfloat(pCanvas->mH), 0.0f, 0.0f, GLfloat(pCanvas->mW) / pCanvas->mTexW, GLfloat(pCanvas->mH) / pCanvas->mTexH, c_White);
+		g.mBatch.Flush();
+	}
+
+	g.mCalls.clear();
+
+	// Objects unloaded while their calls were put off may go now.
+	std::vector<std::pair<int (*)(void *), void *> > unloads;
+
+	unloads.swap(g.mUnloads);
+
+	for (size_t index = 0; index < unloads.size(); ++index) unloads[index].first(unloads[index].second);
+}
+
 /// @brief Sets up the renderer used by the editor
 /// @param width Screen width of mode
 /// @param height Screen height of mode
@@ -20,29 +402,43 @@ int SetupGraphics (int width, int height, int bpp, bool bFullscreen)
 		return 0;
 	}
 
+	Graphics::Main & g = Graphics::Main::Get();
+
 	// Set up TrueType font support.
-	if (FT_Init_FreeType(&Graphics::Main::Get().mFreeType) != 0)
+	if (FT_Init_FreeType(&g.mFreeType) != 0)
 	{
 		std::cerr << "Unable to initialize FreeType2." << std::endl;
 
 		return 0;
 	}
 
-	// Set some OpenGL configuration properties. Set the requested video mode.
-	SDL_GL_SetAttribute(SDL_GL_RED_SIZE, 8);
-	SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8);
-	SDL_GL_SetAttribute(SDL_GL_BLUE_SIZE, 8);
-	SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 16);
-	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+	// Make the selected backend. Set the requested video mode.
+	g.mBackend = Graphics::Backend::Make(g.mRenderer);
+
+	if (0 == g.mBackend)
+	{
+		std::cerr << "Unknown renderer: " << g.mRenderer << std::endl;
+
+		return 0;
+	}
+
+	Graphics::ThreadedBackend * pThreaded = 0;
+
+	if (g.mRenderThread) g.mBackend = pThreaded = new Graphics::ThreadedBackend(g.mBackend);
 
 	if (SetVideoMode(width, height, bpp, bFullscreen) == 0) return 0;
 
-	// Set some nice initial graphical properties. Flag the initialization.
-	glEnable(GL_SCISSOR_TEST);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	// If the device could not be handed to a render thread, drive it directly instead. No
+	// textures have been created yet, so none are named by the wrapper.
+	if (pThreaded != 0 && 0 == pThreaded->mThread)
+	{
+		g.mBackend = pThreaded->Release();
+
+		delete pThreaded;
+	}
 
-	Graphics::Main::Get().mInit = true;
+	// Flag the initialization.
+	g.mInit = true;
 
 	return 1;
 }
@@ -54,31 +450,48 @@ int CloseGraphics (void)
 {
 	Graphics::Main & g = Graphics::Main::Get();
 
-	// Unload all pictures; doing so unloads images, as well.
-	while (!g.mPictures.empty())
-	{
-		UnloadPicture(*g.mPictures.begin());
-	}
+	// Free all blocks, layers, nine-slices, pictures, text images, and fonts in bulk,
+	// invalidating any handles still held; freeing the pictures frees the images, as well.
+	g.mBatch.Flush();
 
-	// Unload all text images and fonts.
-	while (!g.mTextImages.empty())
-	{
-		UnloadTextImage(*g.mTextImages.begin());
-	}
+	g.mRecording = 0;
 
-	while (!g.mFaces.empty())
-	{
-		Graphics::Face * pFace = g.mFaces.begin()->second;
+	g.mTargets.clear();
 
-		while (!pFace->mSizes.empty())
-		{
-			UnloadFont(pFace->mSizes.begin()->second);
-		}
-	}
+	// Drop any calls and unloads put off, and the layer holding the screen.
+	g.mCalls.clear();
+	g.mFrameCalls.clear();
+	g.mUnloads.clear();
+
+	g.mDeferring = false;
+	g.mRepaintAll = true;
+
+	delete g.mCanvas;
+
+	g.mCanvas = 0;
+
+	g.mBlocks.DeleteAll();
+	g.mLayers.DeleteAll();
+	g.mNineSlices.DeleteAll();
+	g.mPictures.DeleteAll();
+	g.mTextImages.DeleteAll();
+	g.mFonts.DeleteAll();
+
+	// Stop decoding images; their pictures are gone.
+	g.mDecoder.Stop();
+
+	for (std::map<std::string, Graphics::Face*>::iterator iter = g.mFaces.begin(); iter != g.mFaces.end(); ++iter) delete iter->second;
+
+	g.mFaces.clear();
 
 	// Close TrueType font support.
 	FT_Done_FreeType(g.mFreeType);
 
+	// Close the backend.
+	delete g.mBackend;
+
+	g.mBackend = 0;
+
 	// Close the video subsystem.
 	if (SDL_WasInit(SDL_INIT_VIDEO)) SDL_QuitSubSystem(SDL_INIT_VIDEO);
 
@@ -99,539 +512,1523 @@ int SetVideoMode (int width, int height, int bpp, bool bFullscreen)
 {
 	Graphics::Main & g = Graphics::Main::Get();
 
-	// Attempt to set an OpenGL video mode, either windowed or full-screen.
-	Uint32 flags = SDL_OPENGL | (bFullscreen ? SDL_FULLSCREEN : 0);
-
-	if (SDL_SetVideoMode(width, height, bpp, flags) == 0)
+	// Attempt to set a video mode, either windowed or full-screen, through the backend.
+	if (!g.mBackend->Open(width, height, bpp, bFullscreen))
 	{
 		std::cerr << "Unable to set video mode: " << SDL_GetError() << std::endl;
 
 		return 0;
 	}
 
-	// Record the resolution. Set up an orthographic projection.
+	// Record the resolution. The whole screen must be repainted.
 	g.mResW = width;
 	g.mResH = height;
 
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
+	g.mRepaint.mX0 = g.mRepaint.mY0 = 0;
+	g.mRepaint.mX1 = width;
+	g.mRepaint.mY1 = height;
+
+	g.mRepaintAll = true;
+
+	return 1;
+}
+
+/// @brief Gets the video dimensions
+/// @param width [out] On success, the video width
+/// @param height [out] On success, the video height
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+int GetVideoSize (Uint32 & width, Uint32 & height)
+{
+	Graphics::Main & g = Graphics::Main::Get();
+
+	width = g.mResW;
+	height = g.mResH;
+
+	return 1;
+}
+
+/// @brief Prepares a render frame used by the editor
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+int PrepareFrame (void)
+{
+	Graphics::Main & g = Graphics::Main::Get();
+
+	// Render into the screen, even if a layer was left unfinished.
+	if (!g.mTargets.empty())
+	{
+		g.mTargets.clear();
+
+		g.ApplyTarget();
+	}
+
+	// When tracking damage, put off calls made to the screen until the frame is drawn. If
+	// the backend does not keep the screen between frames, keep it in a layer instead.
+	g.mDeferring = g.mDamageTracking && (g.mBackend->mRetained || g.mBackend->mTargets);
+
+	if (g.mDeferring && !g.mBackend->mRetained)
+	{
+		if (0 == g.mCanvas) g.mCanvas = new Graphics::Layer;
+
+		Graphics::Layer * pCanvas = g.mCanvas;
+
+		if (pCanvas->mTexW < g.mResW || pCanvas->mTexH < g.mResH)
+		{
+			if (pCanvas->mTexture != 0) g.mBackend->DeleteTexture(pCanvas->mTexture);
+
+			pCanvas->mTexW = g.mBackend->FitTexture(g.mResW);
+			pCanvas->mTexH = g.mBackend->FitTexture(g.mResH);
+			pCanvas->mTexture = g.mBackend->CreateTexture(pCanvas->mTexW, pCanvas->mTexH);
+
+			g.mRepaintAll = true;
+		}
+
+		pCanvas->mW = g.mResW;
+		pCanvas->mH = g.mResH;
+	}
+
+	// A frame drawn in full leaves nothing to compare the next one against.
+	if (!g.mDeferring) g.mRepaintAll = true;
+
+	// Place any images decoded since the last frame, within the upload budget.
+	g.Stream();
+
+	g.mCalls.clear();
+	g.mFrameCalls.clear();
+
+	// Start over from bounds covering the whole screen.
+	ResetBounds(g);
+
+	if (!g.mDeferring) g.mBackend->Clear();
+
+	return 1;
+}
+
+/// @brief Performs the rendering for the editor
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+int DrawFrame (void)
+{
+	Graphics::Main & g = Graphics::Main::Get();
+
+	g.mBatch.Flush();
+
+	if (g.mDeferring) Repaint(g);
+
+	else g.mBackend->mStats.mDamagedPixels = Uint32(g.mResW * g.mResH);
+
+	g.Evict();
+	g.mBackend->Present();
+
+	++g.mFrame;
+
+	return 1;
+}
+
+/// @brief Sets the render bounds
+/// @param fX Screen x coordinate, in [0, 1]
+/// @param fY Screen y coordinate, in [0, 1]
+/// @param fW Screen width, in [0, 1]
+/// @param fH Screen height, in [0, 1]
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+/// @note Inside a PushBounds, the bounds are kept within those pushed
+int SetBounds (float fX, float fY, float fW, float fH)
+{
+	Graphics::Main & g = Graphics::Main::Get();
+
+	Record(g, Graphics::BlockCommand::eSetBounds, 0, fX, fY, fW, fH);
+
+	Graphics::Bounds bounds = { fX, fY, fW, fH };
+
+	g.SetBounds(bounds);
+
+	return 1;
+}
+
+/// @brief Narrows the render bounds, until the matching PopBounds
+/// @param fX Screen x coordinate, in [0, 1]
+/// @param fY Screen y coordinate, in [0, 1]
+/// @param fW Screen width, in [0, 1]
+/// @param fH Screen height, in [0, 1]
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+int PushBounds (float fX, float fY, float fW, float fH)
+{
+	Graphics::Main & g = Graphics::Main::Get();
+
+	Record(g, Graphics::BlockCommand::ePushBounds, 0, fX, fY, fW, fH);
+
+	Graphics::Bounds bounds = { fX, fY, fW, fH };
+
+	g.PushBounds(bounds);
+
+	return 1;
+}
+
+/// @brief Restores the render bounds in force before the last PushBounds
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+int PopBounds (void)
+{
+	Graphics::Main & g = Graphics::Main::Get();
+
+	Record(g, Graphics::BlockCommand::ePopBounds, 0);
+
+	return g.PopBounds() ? 1 : 0;
+}
+
+/// @brief Gets the image loaded from a file, loading it if necessary
+/// @param g Graphics manager
+/// @param name Name of file used to load image data
+/// @param bAsync If true, the image may be left to load in the background
+/// @return Image, or 0 on failure
+/// @note Tested
+static Graphics::Image * GetImage (Graphics::Main & g, char const * name, bool bAsync)
+{
+	// Look for the image associated with the file name. If it is not found, make a new
+	// image and load it into the image map. Attempt to load data into it, unless that is
+	// left to the decoder. A synchronous load sees an image still loading through.
+	std::map<std::string, Graphics::Image*>::iterator iter = g.mImages.find(name);
+
+	if (iter == g.mImages.end())
+	{
+		try {
+			return g.mImages[name] = new Graphics::Image(name, bAsync);
+		} catch (std::bad_alloc &) {
+			return 0;
+		}
+	}
+
+	if (!bAsync && !iter->second->Finish()) return 0;
+
+	return iter->second;
+}
+
+/// @brief Gets a thumbnail of the image in a file, making it in the background if necessary
+/// @param g Graphics manager
+/// @param name Name of file used to load image data
+/// @param size Size toward which the image is reduced
+/// @return Image holding thumbnail, or 0 on failure
+/// @note Tested
+static Graphics::Image * GetThumbnail (Graphics::Main & g, char const * name, GLsizei size)
+{
+	std::pair<std::string, GLsizei> key(name, size);
+
+	std::map<std::pair<std::string, GLsizei>, Graphics::Image*>::iterator iter = g.mThumbnails.find(key);
+
+	if (iter != g.mThumbnails.end()) return iter->second;
+
+	try {
+		return g.mThumbnails[key] = new Graphics::Image(name, true, size);
+	} catch (std::bad_alloc &) {
+		return 0;
+	}
+}
+
+/// @brief Instantiates a picture object
+/// @param g Graphics manager
+/// @param pImage Image used by picture, or 0 if it failed to load
+/// @param fS0 Initial image-relative s-coordinate
+/// @param fT0 Initial image-relative t-coordinate
+/// @param fS1 Terminal image-relative s-coordinate
+/// @param fT1 Terminal image-relative t-coordinate
+/// @param picture [out] On success, handle to a picture object
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+static int NewPicture (Graphics::Main & g, Graphics::Image * pImage, float fS0, float fT0, float fS1, float fT1, Picture_h & picture)
+{
+	if (0 == pImage) return 0;
+
+	// Create a new picture bound to the image, assign its texture coordinates, and add it
+	// to the core's table.
+	Graphics::Picture * Pic = new Graphics::Picture(pImage);
+
+	Pic->mS0 = fS0;
+	Pic->mT0 = fT0;
+	Pic->mS1 = fS1;
+	Pic->mT1 = fT1;
+
+	picture = g.mPictures.Add(Pic);
+
+	if (0 == picture)
+	{
+		delete Pic;
+
+		return 0;
+	}
+
+	return 1;
+}
+
+/// @brief Instantiates a picture object
+/// @param name Name of file used to load picture's image data
+/// @param fS0 Initial image-relative s-coordinate
+/// @param fT0 Initial image-relative t-coordinate
+/// @param fS1 Terminal image-relative s-coordinate
+/// @param fT1 Terminal image-relative t-coordinate
+/// @param picture [out] On success, handle to a picture object
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+int LoadPicture (char const * name, float fS0, float fT0, float fS1, float fT1, Picture_h & picture)
+{
+	if (0 == name) return 0;
+	if (0 == picture) return 0;
+
+	Graphics::Main & g = Graphics::Main::Get();
+
+	return NewPicture(g, GetImage(g, name, false), fS0, fT0, fS1, fT1, picture);
+}
+
+/// @brief Instantiates a picture object at once, its image being decoded in the background
+/// @param name Name of file used to load picture's image data
+/// @param fS0 Initial image-relative s-coordinate
+/// @param fT0 Initial image-relative t-coordinate
+/// @param fS1 Terminal image-relative s-coordinate
+/// @param fT1 Terminal image-relative t-coordinate
+/// @param picture [out] On success, handle to a picture object
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+/// @note The picture draws nothing until its image is placed, a few images each frame;
+/// IsPictureReady reports when it is. Loading an image already loaded is immediate
+int LoadPictureAsync (char const * name, float fS0, float fT0, float fS1, float fT1, Picture_h & picture)
+{
+	if (0 == name) return 0;
+	if (0 == picture) return 0;
+
+	Graphics::Main & g = Graphics::Main::Get();
+
+	return NewPicture(g, GetImage(g, name, true), fS0, fT0, fS1, fT1, picture);
+}
+
+/// @brief Instantiates a picture object drawn from a thumbnail of its image, made in the
+/// background as with LoadPictureAsync
+/// @param name Name of file used to load picture's image data
+/// @param size Size of thumbnail: the image is halved while its larger side is at least
+/// twice this, in [1, 256]
+/// @param fS0 Initial image-relative s-coordinate
+/// @param fT0 Initial image-relative t-coordinate
+/// @param fS1 Terminal image-relative s-coordinate
+/// @param fT1 Terminal image-relative t-coordinate
+/// @param picture [out] On success, handle to a picture object
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+/// @note Thumbnails are kept apart from full-size images, by file name and size, and are
+/// shared by every picture using them
+int LoadThumbnail (char const * name, int size, float fS0, float fT0, float fS1, float fT1, Picture_h & picture)
+{
+	if (0 == name) return 0;
+	if (size < 1 || size > c_MaxThumbnail) return 0;
+	if (0 == picture) return 0;
+
+	Graphics::Main & g = Graphics::Main::Get();
+
+	return NewPicture(g, GetThumbnail(g, name, size), fS0, fT0, fS1, fT1, picture);
+}
+
+/// @brief Indicates whether a picture's image has been loaded
+/// @param picture Handle to the picture object
+/// @param bReady [out] On success, if true, the image is loaded; otherwise, it is loading
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+/// @note Fails if the image could not be loaded
+int IsPictureReady (Picture_h picture, bool & bReady)
+{
+	Graphics::Picture * Pic = Graphics::Main::Get().mPictures.Get(picture);
+
+	if (0 == Pic) return 0;
+
+	bReady = Pic->mImage->IsPlaced();
+
+	return bReady || Pic->mImage->mJob != 0 ? 1 : 0;
+}
+
+/// @brief Counts the images loading in the background
+/// @param decoding [out] On success, count of images still being decoded
+/// @param ready [out] On success, count of images decoded and awaiting placement, which
+/// happens as frames are prepared, a few at a time
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+int GetPendingLoads (Uint32 & decoding, Uint32 & ready)
+{
+	Graphics::Main::Get().mDecoder.Count(decoding, ready);
+
+	return 1;
+}
+
+/// @brief Renders a picture
+/// @param picture Handle to the picture object
+/// @param fX Screen x coordinate, in [0, 1]
+/// @param fY Screen y coordinate, in [0, 1]
+/// @param fW Screen width, in [0, 1]
+/// @param fH Screen height, in [0, 1]
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+int DrawPicture (Picture_h picture, float fX, float fY, float fW, float fH)
+{
+	return DrawPictureEx(picture, fX, fY, fW, fH, false, false);
+}
+
+/// @brief Renders a picture, optionally flipped
+/// @param picture Handle to the picture object
+/// @param fX Screen x coordinate, in [0, 1]
+/// @param fY Screen y coordinate, in [0, 1]
+/// @param fW Screen width, in [0, 1]
+/// @param fH Screen height, in [0, 1]
+/// @param bFlipH If true, the picture is flipped horizontally
+/// @param bFlipV If true, the picture is flipped vertically
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+int DrawPictureEx (Picture_h picture, float fX, float fY, float fW, float fH, bool bFlipH, bool bFlipV)
+{
+	Graphics::Main & g = Graphics::Main::Get();
+
+	Graphics::Picture * Pic = g.mPictures.Get(picture);
+
+	if (0 == Pic) return 0;
+
+	Record(g, Graphics::BlockCommand::ePicture, picture, fX, fY, fW, fH, 0.0f, 0.0f, 0.0f, bFlipH, bFlipV);
+
+	AddPicture(g, Pic, fX, fY, fW, fH, bFlipH, bFlipV, !g.Deferring());
+
+	return 1;
+}
+
+/// @brief Assigns a picture's texels
+/// @param picture Handle to the picture object
+/// @param fS0 Initial image-relative s-coordinate
+/// @param fT0 Initial image-relative t-coordinate
+/// @param fS1 Terminal image-relative s-coordinate
+/// @param fT1 Terminal image-relative t-coordinate
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+int SetPictureTexels (Picture_h picture, float fS0, float fT0, float fS1, float fT1)
+{
+	Graphics::Main & g = Graphics::Main::Get();
+
+	// Convert the handle to a usable form. Assign the texels.
+	Graphics::Picture * Pic = g.mPictures.Get(picture);
+
+	if (0 == Pic) return 0;
+
+	Pic->mS0 = fS0;
+	Pic->mT0 = fT0;
+	Pic->mS1 = fS1;
+	Pic->mT1 = fT1;
+
+	// Calls drawing the picture are unchanged, so they cannot show where it was drawn.
+	g.mRepaintAll = true;
+
+	return 1;
+}
+
+/// @brief Acquires a picture's texels
+/// @param picture Handle to the picture object
+/// @param fS0 [out] On success, initial image-relative s-coordinate
+/// @param fT0 [out] On success, initial image-relative t-coordinate
+/// @param fS1 [out] On success, terminal image-relative s-coordinate
+/// @param fT1 [out] On success, terminal image-relative t-coordinate
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+int GetPictureTexels (Picture_h picture, float & fS0, float & fT0, float & fS1, float & fT1)
+{
+	// Convert the handle to a usable form. Acquire the properties.
+	Graphics::Picture * Pic = Graphics::Main::Get().mPictures.Get(picture);
+
+	if (0 == Pic) return 0;
+
+	fS0 = Pic->mS0;
+	fT0 = Pic->mT0;
+	fS1 = Pic->mS1;
+	fT1 = Pic->mT1;
+
+	return 1;
+}
+
+/// @brief Unloads a picture object from the renderer
+/// @param picture Handle to the picture object
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+int UnloadPicture (Picture_h picture)
+{
+	Graphics::Main & g = Graphics::Main::Get();
+
+	if (g.mDeferring && g.mPictures.Get(picture) != 0) return PutOff(g, UnloadPicture, picture);
+
+	Graphics::Picture * Pic = g.mPictures.Remove(picture);
+
+	if (0 == Pic) return 0;
+
+	delete Pic;
+
+	return 1;
+}
+
+/// @brief Instantiates a font object
+/// @param name Name of file used to load font data
+/// @param size Size in which to load font
+/// @param font [out] On success, handle to a font object
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+int LoadFont (char const * name, int size, Font_h & font)
+{
+	if (0 == name) return 0;
+	if (0 == font) return 0;
+	if (size <= 0) return 0;
+
+	Graphics::Main & g = Graphics::Main::Get();
+
+	// Every name for a file shares its face, and so the face's sizes: the face is known by
+	// its name in the asset pack, or else by the canonical path of its file.
+	Graphics::PackEntry const * pEntry = g.mPack.Find(name);
+
+	std::string path = pEntry != 0 ? g.mPack.GetName(pEntry) : Graphics::CanonicalPath(name);
+
+	if (path.empty()) return 0;
+
+	// Load the face if it is not loaded. Acquire the size.
+	std::map<std::string, Graphics::Face*>::iterator iter = g.mFaces.find(path);
+
+	if (iter == g.mFaces.end())
+	{
+		try {
+			iter = g.mFaces.insert(std::make_pair(path, new Graphics::Face(path))).first;
+		} catch (std::bad_alloc &) {
+			return 0;
+		}
+	}
+
+	Graphics::Font * pFont = iter->second->GetSize(size);
+
+	if (0 == pFont)
+	{
+		// Drop a face left without sizes.
+		if (iter->second->mSizes.empty())
+		{
+			delete iter->second;
+
+			g.mFaces.erase(iter);
+		}
+
+		return 0;
+	}
+
+	font = pFont->mHandle;
+
+	return 1;
+}
+
+/// @brief Unloads a font object from the renderer
+/// @param font Handle to a font object
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+int UnloadFont (Font_h font)
+{
+	Graphics::Main & g = Graphics::Main::Get();
+
+	// Release the handle. Once the last one goes, remove the size from its face.
+	Graphics::Font * pFont = g.mFonts.Get(font);
+
+	if (0 == pFont) return 0;
+
+	if (g.mDeferring) return PutOff(g, UnloadFont, font);
+
+	Graphics::Face * pFace = pFont->mFace;
+
+	assert(pFont->mCount > 0);
+
+	if (--pFont->mCount != 0) return 1;
+
+	g.mFonts.Remove(font);
+
+	pFace->mSizes.erase(pFont->mPixels);
+
+	delete pFont;
+
+	// If the last size is removed, unload the face itself.
+	if (pFace->mSizes.empty())
+	{
+		g.mFaces.erase(pFace->mName);
+
+		delete pFace;
+	}
+
+	return 1;
+}
+
+/// @brief Gets the dimensions of a text string constructed from a given font object
+/// @param font Handle to a font object
+/// @param text Text string whose size is being determined
+/// @param width [out] On success, the string's width
+/// @param height [out] On success, the string's height
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+int GetTextSize (Font_h font, char const * text, int & width, int & height)
+{
+	if (0 == text) return 0;
+
+	Graphics::Font * pFont = Graphics::Main::Get().mFonts.Get(font);
+
+	if (0 == pFont) return 0;
+
+	// Accumulate the cached advances.
+	FT_Pos pen = 0;
+
+	for (Uint32 index = 0; text[index] != '\0'; ++index)
+	{
+		pen += pFont->GetAdvance(static_cast<Uint8>(text[index]));
+	}
+
+	width = int(pen / 64);
+	height = pFont->mSize->metrics.height / 64 + 1;
+
+	return 1;
+}
+
+/// @brief Gets the width of each leading substring of a text string
+/// @param font Handle to a font object
+/// @param text Text string whose widths are being determined
+/// @param widths [out] On success, widths[i] is the width of the first i + 1 characters;
+/// must have room for one entry per character
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+int GetTextWidths (Font_h font, char const * text, int * widths)
+{
+	if (0 == text) return 0;
+	if (0 == widths) return 0;
+
+	Graphics::Font * pFont = Graphics::Main::Get().mFonts.Get(font);
+
+	if (0 == pFont) return 0;
+
+	// Accumulate the cached advances, recording the pen position after each character.
+	FT_Pos pen = 0;
+
+	for (Uint32 index = 0; text[index] != '\0'; ++index)
+	{
+		pen += pFont->GetAdvance(static_cast<Uint8>(text[index]));
+
+		widths[index] = int(pen / 64);
+	}
+
+	return 1;
+}
+
+/// @brief Generates a renderable text image from a font
+/// @param font Handle to a font object, used to generate the text image
+/// @param text The text to render in the text image
+/// @param color The color of the rendered text image
+/// @param textImage [out] On success, handle to a text image object
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+int LoadTextImage (Font_h font, char const * text, SDL_Color color, TextImage_h & textImage)
+{
+	if (0 == text) return 0;
+	if (0 == textImage) return 0;
+
+	Graphics::Main & g = Graphics::Main::Get();
+
+	Graphics::Font * pFont = g.mFonts.Get(font);
+
+	if (0 == pFont) return 0;
+
+	Graphics::TextImage * Text;
+
+	try {
+		Text = new Graphics::TextImage(pFont, text, color);
+	} catch (std::bad_alloc &) {
+		return 0;
+	}
+
+	textImage = g.mTextImages.Add(Text);
+
+	if (0 == textImage)
+	{
+		delete Text;
+
+		return 0;
+	}
+
+	return 1;
+}
+
+/// @brief Renders a text image
+/// @param textImage Handle to a text image object
+/// @param fX Screen x coordinate, in [0, 1]
+/// @param fY Screen y coordinate, in [0, 1]
+/// @param fW Screen width, in [0, 1]
+/// @param fH Screen height, in [0, 1]
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+int DrawTextImage (TextImage_h textImage, float fX, float fY, float fW, float fH)
+{
+	Graphics::Main & g = Graphics::Main::Get();
+
+	Graphics::TextImage * Text = g.mTextImages.Get(textImage);
+
+	if (0 == Text) return 0;
+
+	Record(g, Graphics::BlockCommand::eTextImage, textImage, fX, fY, fW, fH);
+
+	// Transform the provided coordinates and dimensions into a form OpenGL expects, and
+	// scale them to the current resolution.
+	float fSX = fX;
+	float fEX = fX + fW;
+	float fSY = 1.0f - fY - fH;
+	float fEY = 1.0f - fY;
+
+	fSX *= g.mResW;
+	fEX *= g.mResW;
+	fSY *= g.mResH;
+	fEY *= g.mResH;
+
+	// While the call is put off, keep the texture of a text image on screen from eviction.
+	if (g.Deferring())
+	{
+		if (Text->mTexture != 0 && g.mBatch.InClip(fSX, fSY, fEX, fEY)) Text->mUsed = g.mFrame;
+
+		return 1;
+	}
+
+	if (g.mBatch.CullQuads(fSX, fSY, fEX, fEY, 1)) return 1;
+
+	// Batch a quad with the requested properties, using the text image's texture.
+	g.Use(Text);
+	g.mBatch.Prepare(Text->mTexture, GL_QUADS);
+	g.mBatch.AddQuad(fSX, fSY, fEX, fEY, 0.0f, Text->mT, Text->mS, 0.0f, Text->mColor);
+
+	return 1;
+}
+
+/// @brief Renders a string of text
+/// @param font Handle to a font object, used to render the text
+/// @param text The text to render
+/// @param fX Screen x coordinate, in [0, 1]
+/// @param fY Screen y coordinate, in [0, 1]
+/// @param color The color of the rendered text
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+int DrawText (Font_h font, char const * text, float fX, float fY, SDL_Color color)
+{
+	if (0 == text) return 0;
+
+	Graphics::Main & g = Graphics::Main::Get();
+
+	Graphics::Font * pFont = g.mFonts.Get(font);
+
+	if (0 == pFont) return 0;
+
+	Record(g, Graphics::BlockCommand::eText, font, fX, fY, 0.0f, 0.0f, color.r, color.g, color.b, 0, 0, text);
+
+	if (g.Deferring()) return 1;
+
+	// Find the pen position and baseline, snapped to whole pixels so that glyphs map
+	// one-to-one onto screen pixels.
+	FT_Pos pen = FT_Pos(floorf(fX * g.mResW + 0.5f)) * 64;
+	float fBase = floorf((1.0f - fY) * g.mResH + 0.5f) - Ceiling(pFont->mSize->metrics.ascender) / 64;
+
+	GLubyte rgba[4] = { color.r, color.g, color.b, 0xFF };
+
+	// Fonts backed by distance fields draw the face's shared glyphs, scaled to size.
+	Graphics::Font * pGlyphs = pFont->mField != 0 ? pFont->mField : pFont;
+
+	float fScale = float(pFont->mPixels) / pGlyphs->mPixels;
+
+	// Skip lines of text lying wholly above or below the bounds, with a line's height of
+	// slack for glyphs that overshoot the font's ascent or descent.
+	float fHeight = float(Ceiling(pFont->mSize->metrics.height) / 64);
+
+	if (g.mBatch.CullQuads(0.0f, fBase - fHeight, float(g.mResW), fBase + 2.0f * fHeight, Uint32(strlen(text)))) return 1;
+
+	// Batch a quad for each visible glyph, and advance the pen.
+	for (Uint32 index = 0; text[index] != '\0'; ++index)
+	{
+		Uint8 code = static_cast<Uint8>(text[index]);
+
+		Graphics::Glyph const & glyph = pGlyphs->GetGlyph(code);
+
+		if (glyph.mPage != 0)
+		{
+			float fSX = float(pen / 64) + glyph.mLeft * fScale;
+			float fEX = fSX + glyph.mW * fScale;
+			float fEY = fBase + glyph.mTop * fScale;
+			float fSY = fEY - glyph.mH * fScale;
+
+			if (!g.mBatch.CullQuads(fSX, fSY, fEX, fEY, 1))
+			{
+				g.mBatch.Prepare(glyph.mPage->mTexture, GL_QUADS, pGlyphs->mSpread != 0 ? Graphics::eField : Graphics::eBlend);
+				g.mBatch.AddQuad(fSX, fSY, fEX, fEY, glyph.mS0, glyph.mT1, glyph.mS1, glyph.mT0, rgba);
+			}
+		}
+
+		pen += pFont->GetAdvance(code);
+	}
+
+	return 1;
+}
+
+/// @brief Unloads a text image object from the renderer
+/// @param textImage Handle to a text image object
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+int UnloadTextImage (TextImage_h textImage)
+{
+	Graphics::Main & g = Graphics::Main::Get();
+
+	if (g.mDeferring && g.mTextImages.Get(textImage) != 0) return PutOff(g, UnloadTextImage, textImage);
+
+	Graphics::TextImage * Text = g.mTextImages.Remove(textImage);
+
+	if (0 == Text) return 0;
+
+	delete Text;
+
+	return 1;
+}
+
+/// @brief Renders a square, unfilled box in the given color
+/// @param fX Screen x coordinate, in [0, 1]
+/// @param fY Screen y coordinate, in [0, 1]
+/// @param fW Screen width, in [0, 1]
+/// @param fH Screen height, in [0, 1]
+/// @param fR Red value, in [0, 1]
+/// @param fG Green value, in [0, 1]
+/// @param fB Blue value, in [0, 1]
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+int DrawBox (float fX, float fY, float fW, float fH, float fR, float fG, float fB)
+{
+	Graphics::Main & g = Graphics::Main::Get();
+
+	Record(g, Graphics::BlockCommand::eBox, 0, fX, fY, fW, fH, fR, fG, fB);
+
+	if (g.Deferring()) return 1;
+
+	// Transform the provided coordinates and dimensions into a form OpenGL expects, and
+	// scale them to the current resolution.
+	float fSX = floorf(fX * g.mResW);
+	float fSY = floorf((1.0f - fY - fH) * g.mResH);
+	float fEX = fSX + floorf(fW * g.mResW - 0.5f);
+	float fEY = fSY + floorf(fH * g.mResH - 0.5f);
+
+	if (g.mBatch.CullLines(fSX, fSY, fEX, fEY, 4)) return 1;
+
+	// Batch an unfilled, untextured box in the desired color.
+	GLubyte color[4];	PackColor(fR, fG, fB, color);
+
+	g.mBatch.Prepare(0, GL_LINES);
+
+	AddBox(g.mBatch, fSX, fSY, fEX, fEY, color);
+
+	return 1;
+}
+
+/// @brief Renders a line in the given color
+/// @param fSX Screen start x coordinate, in [0, 1]
+/// @param fSY Screen start y coordinate, in [0, 1]
+/// @param fEX Screen end x coordinate, in [0, 1]
+/// @param fEY Screen end y coordinate, in [0, 1]
+/// @param fR Red value, in [0, 1]
+/// @param fG Green value, in [0, 1]
+/// @param fB Blue value, in [0, 1]
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+int DrawLine (float fSX, float fSY, float fEX, float fEY, float fR, float fG, float fB)
+{
+	Graphics::Main & g = Graphics::Main::Get();
+
+	Record(g, Graphics::BlockCommand::eLine, 0, fSX, fSY, fEX, fEY, fR, fG, fB);
+
+	if (g.Deferring()) return 1;
+
+	fSX *= g.mResW;
+	fSY = (1.0f - fSY) * g.mResH;
+	fEX *= g.mResW;
+	fEY = (1.0f - fEY) * g.mResH;
+
+	if (g.mBatch.CullLines(std::min(fSX, fEX), std::min(fSY, fEY), std::max(fSX, fEX), std::max(fSY, fEY), 1)) return 1;
+
+	// Batch an untextured line in the desired color.
+	GLubyte color[4];	PackColor(fR, fG, fB, color);
+
+	g.mBatch.Prepare(0, GL_LINES);
+	g.mBatch.AddLine(fSX, fSY, fEX, fEY, color);
+
+	return 1;
+}
+
+/// @brief Renders a square, unfilled grid in the current color
+/// @param fX Screen x coordinate, in [0, 1]
+/// @param fY Screen y coordinate, in [0, 1]
+/// @param fW Screen width, in [0, 1]
+/// @param fH Screen height, in [0, 1]
+/// @param fR Red value, in [0, 1]
+/// @param fG Green value, in [0, 1]
+/// @param fB Blue value, in [0, 1]
+/// @param xCuts Number of horizontal partitions
+/// @param yCuts Number of vertical partitions
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+int DrawGrid (float fX, float fY, float fW, float fH, float fR, float fG, float fB, Uint32 xCuts, Uint32 yCuts)
+{
+	Graphics::Main & g = Graphics::Main::Get();
+
+	Record(g, Graphics::BlockCommand::eGrid, 0, fX, fY, fW, fH, fR, fG, fB, xCuts, yCuts);
+
+	if (g.Deferring()) return 1;
+
+	// Transform the provided coordinates and dimensions into a form OpenGL expects, and
+	// scale them to the current resolution.
+	float fSX = floorf(fX * g.mResW);
+	float fSY = floorf((1.0f - fY - fH) * g.mResH);
+	float fEX = fSX + floorf(fW * g.mResW - 0.5f);
+	float fEY = fSY + floorf(fH * g.mResH - 0.5f);
+
+	if (g.mBatch.CullLines(fSX, fSY, fEX, fEY, xCuts + yCuts + 4)) return 1;
+
+	// Batch untextured lines in the desired color.
+	GLubyte color[4];	PackColor(fR, fG, fB, color);
+
+	g.mBatch.Prepare(0, GL_LINES);
+
+	// Add the horizontal and vertical lines.
+	float fDW = (fEX - fSX) / (xCuts + 1);
+
+	for (fX = fSX + fDW; xCuts-- != 0; fX += fDW) g.mBatch.AddLine(fX, fSY, fX, fEY, color);
+
+	float fDH = (fEY - fSY) / (yCuts + 1);
+
+	for (fY = fSY + fDH; yCuts-- != 0; fY += fDH) g.mBatch.AddLine(fSX, fY, fEX, fY, color);
+
+	// Add an unfilled box.
+	AddBox(g.mBatch, fSX, fSY, fEX, fEY, color);
+
+	return 1;
+}
+
+/// @brief Instantiates a nine-slice object, with empty cells
+/// @param nineSlice [out] On success, handle to a nine-slice object
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+int LoadNineSlice (NineSlice_h & nineSlice)
+{
+	Graphics::NineSlice * pSlice = new Graphics::NineSlice;
+
+	nineSlice = Graphics::Main::Get().mNineSlices.Add(pSlice);
+
+	if (0 == nineSlice)
+	{
+		delete pSlice;
+
+		return 0;
+	}
+
+	return 1;
+}
+
+/// @brief Assigns the picture drawn in one cell of a nine-slice
+/// @param nineSlice Handle to a nine-slice object
+/// @param cell Cell index, from 1 to 9, left to right and top to bottom
+/// @param picture Handle to a picture object, or 0 to empty the cell
+/// @param bFlipH If true, the picture is flipped horizontally
+/// @param bFlipV If true, the picture is flipped vertically
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+/// @note The cell holds the handle, so later changes to the picture's texels show up
+int SetNineSliceCell (NineSlice_h nineSlice, int cell, Picture_h picture, bool bFlipH, bool bFlipV)
+{
+	if (cell < 1 || cell > 9) return 0;
+
+	Graphics::Main & g = Graphics::Main::Get();
+
+	Graphics::NineSlice * pSlice = g.mNineSlices.Get(nineSlice);
+
+	if (0 == pSlice) return 0;
+
+	Graphics::NineSlice::Cell & entry = pSlice->mCells[cell - 1];
+
+	entry.mPicture = picture;
+	entry.mFlipH = bFlipH;
+	entry.mFlipV = bFlipV;
+
+	g.mRepaintAll = true;
+
+	return 1;
+}
+
+/// @brief Assigns the stretch thresholds of a nine-slice
+/// @param nineSlice Handle to a nine-slice object
+/// @param fStretchW Width, in [0, 1], above which the middle column stretches
+/// @param fStretchH Height, in [0, 1], above which the middle row stretches
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+int SetNineSliceThresholds (NineSlice_h nineSlice, float fStretchW, float fStretchH)
+{
+	Graphics::Main & g = Graphics::Main::Get();
+
+	Graphics::NineSlice * pSlice = g.mNineSlices.Get(nineSlice);
+
+	if (0 == pSlice) return 0;
+
+	pSlice->mStretchW = fStretchW;
+	pSlice->mStretchH = fStretchH;
+
+	g.mRepaintAll = true;
+
+	return 1;
+}
+
+/// @brief Renders a nine-slice
+/// @param nineSlice Handle to a nine-slice object
+/// @param fX Screen x coordinate, in [0, 1]
+/// @param fY Screen y coordinate, in [0, 1]
+/// @param fW Screen width, in [0, 1]
+/// @param fH Screen height, in [0, 1]
+/// @param bIgnore If true, empty cells are skipped; otherwise, they are outlined
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+/// @note The corners are each half a threshold across, or half the nine-slice if it is
+/// smaller; the sides and middle take up the rest, and are left out if nothing remains
+int DrawNineSlice (NineSlice_h nineSlice, float fX, float fY, float fW, float fH, bool bIgnore)
+{
+	Graphics::Main & g = Graphics::Main::Get();
+
+	Graphics::NineSlice * pSlice = g.mNineSlices.Get(nineSlice);
+
+	if (0 == pSlice) return 0;
+
+	Record(g, Graphics::BlockCommand::eNineSlice, nineSlice, fX, fY, fW, fH, 0.0f, 0.0f, 0.0f, bIgnore);
+
+	// While the call is put off, the cells' textures are only marked as in use.
+	bool bDraw = !g.Deferring();
+
+	// Outlines of empty cells are part of this call, so keep them out of any block.
+	Graphics::Block * pRecording = g.mRecording;
+
+	g.mRecording = 0;
+
+	// Lay out the columns and rows.
+	float fEW = std::max(fW - pSlice->mStretchW, 0.0f), fCW = std::min(pSlice->mStretchW, fW) / 2;
+	float fEH = std::max(fH - pSlice->mStretchH, 0.0f), fCH = std::min(pSlice->mStretchH, fH) / 2;
+
+	float const xs[3] = { fX, fX + fCW, fX + fCW + fEW }, ws[3] = { fCW, fEW, fCW };
+	float const ys[3] = { fY, fY + fCH, fY + fCH + fEH }, hs[3] = { fCH, fEH, fCH };
+
+	// Batch each cell with room to draw, outlining empty ones if asked.
+	for (int row = 0; row < 3; ++row)
+	{
+		if (1 == row && 0 == fEH) continue;
+
+		for (int col = 0; col < 3; ++col)
+		{
+			if (1 == col && 0 == fEW) continue;
+
+			Graphics::NineSlice::Cell const & cell = pSlice->mCells[row * 3 + col];
+
+			Graphics::Picture * Pic = g.mPictures.Get(cell.mPicture);
+
+			if (Pic != 0) AddPicture(g, Pic, xs[col], ys[row], ws[col], hs[row], cell.mFlipH, cell.mFlipV, bDraw);
+
+			else if (!bIgnore && bDraw) DrawBox(xs[col], ys[row], ws[col], hs[row], 1.0f, 1.0f, 1.0f);
+		}
+	}
+
+	g.mRecording = pRecording;
+
+	return 1;
+}
+
+/// @brief Unloads a nine-slice object from the renderer
+/// @param nineSlice Handle to a nine-slice object
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+/// @note The pictures in its cells are left loaded
+int UnloadNineSlice (NineSlice_h nineSlice)
+{
+	Graphics::Main & g = Graphics::Main::Get();
+
+	if (g.mDeferring && g.mNineSlices.Get(nineSlice) != 0) return PutOff(g, UnloadNineSlice, nineSlice);
+
+	Graphics::NineSlice * pSlice = g.mNineSlices.Remove(nineSlice);
+
+	if (0 == pSlice) return 0;
+
+	delete pSlice;
+
+	return 1;
+}
+
+/// @brief Instantiates an empty block object
+/// @param block [out] On success, handle to a block object
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+int LoadBlock (Block_h & block)
+{
+	Graphics::Block * pBlock = new Graphics::Block;
+
+	block = Graphics::Main::Get().mBlocks.Add(pBlock);
+
+	if (0 == block)
+	{
+		delete pBlock;
+
+		return 0;
+	}
+
+	return 1;
+}
+
+/// @brief Empties a block and records into it the draw and bounds calls made until
+/// EndBlock; the calls are still carried out as they are made
+/// @param block Handle to a block object
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+/// @note Calls are recorded by handle, so later changes to pictures and the like show up
+/// on replay; fails if another block is being recorded
+int BeginBlock (Block_h block)
+{
+	Graphics::Main & g = Graphics::Main::Get();
+
+	Graphics::Block * pBlock = g.mBlocks.Get(block);
+
+	if (0 == pBlock || g.mRecording != 0) return 0;
+
+	pBlock->mCommands.clear();
+
+	g.mRecording = pBlock;
+
+	return 1;
+}
+
+/// @brief Stops recording into the block passed to BeginBlock
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+int EndBlock (void)
+{
+	Graphics::Main & g = Graphics::Main::Get();
+
+	if (0 == g.mRecording) return 0;
 
-	glOrtho(0.0, double(width), 0.0, double(height), +1.0, -1.0);
+	g.mRecording = 0;
 
 	return 1;
 }
 
-/// @brief Gets the video dimensions
-/// @param width [out] On success, the video width
-/// @param height [out] On success, the video height
+/// @brief Replays the calls recorded into a block
+/// @param block Handle to a block object
+/// @param fX Screen x offset, in [-1, 1], added to every recorded position
+/// @param fY Screen y offset, in [-1, 1], added to every recorded position
 /// @return 0 on failure, non-0 for success
 /// @note Tested
-int GetVideoSize (Uint32 & width, Uint32 & height)
+/// @note While another block is being recorded, the replayed calls are recorded into it
+int DrawBlock (Block_h block, float fX, float fY)
 {
 	Graphics::Main & g = Graphics::Main::Get();
 
-	width = g.mResW;
-	height = g.mResH;
+	Graphics::Block * pBlock = g.mBlocks.Get(block);
+
+	// A block may not be replayed into itself.
+	if (0 == pBlock || pBlock == g.mRecording) return 0;
+
+	Replay(pBlock->mCommands, fX, fY);
 
 	return 1;
 }
 
-/// @brief Prepares a render frame used by the editor
+/// @brief Unloads a block object from the renderer
+/// @param block Handle to a block object
 /// @return 0 on failure, non-0 for success
 /// @note Tested
-int PrepareFrame (void)
+int UnloadBlock (Block_h block)
 {
 	Graphics::Main & g = Graphics::Main::Get();
 
-	glScissor(0, 0, g.mResW, g.mResH);
-	glClear(GL_COLOR_BUFFER_BIT);
+	Graphics::Block * pBlock = g.mBlocks.Remove(block);
+
+	if (0 == pBlock) return 0;
+
+	if (pBlock == g.mRecording) g.mRecording = 0;
+
+	delete pBlock;
 
 	return 1;
 }
 
-/// @brief Performs the rendering for the editor
+/// @brief Instantiates a layer object, with nothing rendered into it
+/// @param layer [out] On success, handle to a layer object
 /// @return 0 on failure, non-0 for success
 /// @note Tested
-int DrawFrame (void)
+int LoadLayer (Layer_h & layer)
 {
-	SDL_GL_SwapBuffers();
+	Graphics::Layer * pLayer = new Graphics::Layer;
+
+	layer = Graphics::Main::Get().mLayers.Add(pLayer);
+
+	if (0 == layer)
+	{
+		delete pLayer;
+
+		return 0;
+	}
 
 	return 1;
 }
 
-/// @brief Sets the render bounds
+/// @brief Renders into a layer, until EndLayer, everything drawn within a screen rectangle;
+/// the layer starts out transparent
+/// @param layer Handle to a layer object
 /// @param fX Screen x coordinate, in [0, 1]
 /// @param fY Screen y coordinate, in [0, 1]
 /// @param fW Screen width, in [0, 1]
 /// @param fH Screen height, in [0, 1]
 /// @return 0 on failure, non-0 for success
 /// @note Tested
-int SetBounds (float fX, float fY, float fW, float fH)
+/// @note Fails if the backend cannot render into textures, if the layer is already being
+/// rendered into, or if a block is being recorded; the caller then draws as usual
+int BeginLayer (Layer_h layer, float fX, float fY, float fW, float fH)
 {
 	Graphics::Main & g = Graphics::Main::Get();
 
-	fX *= g.mResW;
-	fY = (1.0f - fY - fH) * g.mResH;
-	fW *= g.mResW;
-	fH *= g.mResH;
+	Graphics::Layer * pLayer = g.mLayers.Get(layer);
 
-	fX = floorf(fX), fY = floorf(fY);
-	fW = ceilf(fW), fH = ceilf(fH);
+	if (0 == pLayer || !g.mBackend->mTargets || g.mRecording != 0) return 0;
+	if (std::find(g.mTargets.begin(), g.mTargets.end(), pLayer) != g.mTargets.end()) return 0;
 
-	glScissor(GLint(fX), GLint(fY), GLsizei(fW), GLsizei(fH));
+	// Find the pixels covered by the rectangle, on screen.
+	GLint left = std::max(GLint(floorf(fX * g.mResW)), 0), right = std::min(GLint(ceilf((fX + fW) * g.mResW)), GLint(g.mResW));
+	GLint bottom = std::max(GLint(floorf((1.0f - fY - fH) * g.mResH)), 0), top = std::min(GLint(ceilf((1.0f - fY) * g.mResH)), GLint(g.mResH));
 
-	return 1;
-}
+	if (left >= right || bottom >= top) return 0;
 
-/// @brief Instantiates a picture object
-/// @param name Name of file used to load picture's image data
-/// @param fS0 Initial texture s-coordinate
-/// @param fT0 Initial texture t-coordinate
-/// @param fS1 Terminal texture s-coordinate
-/// @param fT1 Terminal texture t-coordinate
-/// @param picture [out] On success, handle to a picture object
-/// @return 0 on failure, non-0 for success
-/// @note Tested
-int LoadPicture (char const * name, float fS0, float fT0, float fS1, float fT1, Picture_h & picture)
-{
-	if (0 == name) return 0;
-	if (0 == picture) return 0;
+	g.mBatch.Flush();
 
-	Graphics::Main & g = Graphics::Main::Get();
+	// Grow the texture if the rectangle no longer fits in it.
+	GLsizei w = right - left, h = top - bottom;
 
-	// Look for the image associated with the file name. If it is not found, make a new
-	// image and load it into the image map. Attempt to load data into it.
-	if (g.mImages.find(name) == g.mImages.end())
+	if (w > pLayer->mTexW || h > pLayer->mTexH)
 	{
-		try {
-			g.mImages[name] = new Graphics::Image(name);
-		} catch (std::bad_alloc &) {
-			return 0;
-		}
-	}
+		if (pLayer->mTexture != 0) g.mBackend->DeleteTexture(pLayer->mTexture);
 
-	// Create a new picture bound to the image, assign its texture coordinates, and add it
-	// to the core's list.
-	Graphics::Picture * Pic = new Graphics::Picture(g.mImages[name]);
+		pLayer->mTexW = g.mBackend->FitTexture(std::max(w, pLayer->mTexW));
+		pLayer->mTexH = g.mBackend->FitTexture(std::max(h, pLayer->mTexH));
+		pLayer->mTexture = g.mBackend->CreateTexture(pLayer->mTexW, pLayer->mTexH);
+	}
 
-	Pic->mS0 = fS0;
-	Pic->mT0 = fT0;
-	Pic->mS1 = fS1;
-	Pic->mT1 = fT1;
+	pLayer->mX = left;
+	pLayer->mY = bottom;
+	pLayer->mW = w;
+	pLayer->mH = h;
+	pLayer->mRendered = g.mFrame;
+	pLayer->mPlaced = g.mPlaced;
+	pLayer->mMissing = false;
 
-	g.mPictures.push_back(Pic);
+	// Render into the layer, clearing all of it before putting the bounds back in force.
+	g.mTargets.push_back(pLayer);
 
-	picture = Pic;
+	g.mBackend->SetTarget(pLayer->mTexture, left, bottom, w, h);
 
-	return 1;
-}
+	// Give up on the layer, dropping its texture so that it is not drawn, if the backend
+	// found it could not render into the texture.
+	if (!g.mBackend->mTargets)
+	{
+		g.mTargets.pop_back();
 
-/// @brief Renders a picture
-/// @param picture Handle to the picture object
-/// @param fX Screen x coordinate, in [0, 1]
-/// @param fY Screen y coordinate, in [0, 1]
-/// @param fW Screen width, in [0, 1]
-/// @param fH Screen height, in [0, 1]
-/// @return 0 on failure, non-0 for success
-/// @note Tested
-int DrawPicture (Picture_h picture, float fX, float fY, float fW, float fH)
-{
-	if (0 == picture) return 0;
+		g.ApplyTarget();
 
-	Graphics::Main & g = Graphics::Main::Get();
+		g.mBackend->DeleteTexture(pLayer->mTexture);
 
-	// Transform the provided coordinates and dimensions into a form OpenGL expects, and
-	// scale them to the current resolution.
-	float fSX = fX;
-	float fEX = fX + fW;
-	float fSY = 1.0f - fY - fH;
-	float fEY = 1.0f - fY;
+		pLayer->mTexture = 0;
+		pLayer->mTexW = pLayer->mTexH = 0;
 
-	fSX *= g.mResW;
-	fEX *= g.mResW;
-	fSY *= g.mResH;
-	fEY *= g.mResH;
+		return 0;
+	}
 
-	// Convert the handle to a usable form. Set OpenGL up to render the picture's image
-	// texture and draw a quad with the requested properties, using the texture data 
-	// assigned to the picture.
-	Graphics::Picture * Pic = static_cast<Graphics::Picture*>(picture);
+	g.mBackend->Scissor(left, bottom, w, h);
+	g.mBackend->Clear();
 
-	glEnable(GL_TEXTURE_2D);
-	glBindTexture(GL_TEXTURE_2D, Pic->mImage->mTexture);
+	g.ApplyBounds();
 
-	glBegin(GL_QUADS);
-		glTexCoord2f(Pic->mS0, Pic->mT1);	glVertex2f(fSX, fSY);
-		glTexCoord2f(Pic->mS1, Pic->mT1);	glVertex2f(fEX, fSY);
-		glTexCoord2f(Pic->mS1, Pic->mT0);	glVertex2f(fEX, fEY);
-		glTexCoord2f(Pic->mS0, Pic->mT0);	glVertex2f(fSX, fEY);
-	glEnd();
+	++g.mBackend->mStats.mLayerRenders;
 
 	return 1;
 }
 
-/// @brief Assigns a picture's texels
-/// @param picture Handle to the picture object
-/// @param fS0 Initial texture s-coordinate
-/// @param fT0 Initial texture t-coordinate
-/// @param fS1 Terminal texture s-coordinate
-/// @param fT1 Terminal texture t-coordinate
+/// @brief Stops rendering into the layer passed to the last BeginLayer
 /// @return 0 on failure, non-0 for success
 /// @note Tested
-int SetPictureTexels (Picture_h picture, float fS0, float fT0, float fS1, float fT1)
+int EndLayer (void)
 {
-	if (0 == picture) return 0;
+	Graphics::Main & g = Graphics::Main::Get();
 
-	// Convert the handle to a usable form. Assign the texels.
-	Graphics::Picture * Pic = static_cast<Graphics::Picture*>(picture);
+	if (g.mTargets.empty()) return 0;
 
-	Pic->mS0 = fS0;
-	Pic->mT0 = fT0;
-	Pic->mS1 = fS1;
-	Pic->mT1 = fT1;
+	// Submit what was drawn into the layer before rendering into the outer target.
+	g.mBatch.Flush();
+
+	g.mTargets.pop_back();
+
+	g.ApplyTarget();
 
 	return 1;
 }
 
-/// @brief Acquires a picture's texels
-/// @param picture Handle to the picture object
-/// @param fS0 [out] On success, initial texture s-coordinate
-/// @param fT0 [out] On success, initial texture t-coordinate
-/// @param fS1 [out] On success, terminal texture s-coordinate
-/// @param fT1 [out] On success, terminal texture t-coordinate
+/// @brief Draws a layer as one quad
+/// @param layer Handle to a layer object
+/// @param fX Screen x offset, in [-1, 1], from where the layer was rendered
+/// @param fY Screen y offset, in [-1, 1], from where the layer was rendered
 /// @return 0 on failure, non-0 for success
 /// @note Tested
-int GetPictureTexels (Picture_h picture, float & fS0, float & fT0, float & fS1, float & fT1)
+/// @note Fails if nothing has been rendered into the layer, or it is being rendered into,
+/// or it left out pictures that have since loaded
+int DrawLayer (Layer_h layer, float fX, float fY)
 {
-	if (0 == picture) return 0;
+	Graphics::Main & g = Graphics::Main::Get();
 
-	// Convert the handle to a usable form. Acquire the properties.
-	Graphics::Picture * Pic = static_cast<Graphics::Picture*>(picture);
+	Graphics::Layer * pLayer = g.mLayers.Get(layer);
 
-	fS0 = Pic->mS0;
-	fT0 = Pic->mT0;
-	fS1 = Pic->mS1;
-	fT1 = Pic->mT1;
+	if (0 == pLayer || 0 == pLayer->mTexture) return 0;
+	if (std::find(g.mTargets.begin(), g.mTargets.end(), pLayer) != g.mTargets.end()) return 0;
+	if (pLayer->mMissing && pLayer->mPlaced != g.mPlaced) return 0;
+
+	Record(g, Graphics::BlockCommand::eLayer, layer, fX, fY);
+
+	if (g.Deferring()) return 1;
+
+	// Move by whole pixels, so that texels land on pixels as they were rendered.
+	float fSX = pLayer->mX + floorf(fX * g.mResW + 0.5f), fEX = fSX + pLayer->mW;
+	float fSY = pLayer->mY - floorf(fY * g.mResH + 0.5f), fEY = fSY + pLayer->mH;
+
+	if (g.mBatch.CullQuads(fSX, fSY, fEX, fEY, 1)) return 1;
+
+	// The layer's colors are premultiplied by alpha.
+	g.mBatch.Prepare(pLayer->mTexture, GL_QUADS, Graphics::ePremultiplied);
+	g.mBatch.AddQuad(fSX, fSY, fEX, fEY, 0.0f, 0.0f, GLfloat(pLayer->mW) / pLayer->mTexW, GLfloat(pLayer->mH) / pLayer->mTexH, c_White);
 
 	return 1;
 }
 
-/// @brief Unloads a picture object from the renderer
-/// @param picture Handle to the picture object
+/// @brief Unloads a layer object from the renderer
+/// @param layer Handle to a layer object
 /// @return 0 on failure, non-0 for success
 /// @note Tested
-int UnloadPicture (Picture_h picture)
+/// @note Fails if the layer is being rendered into
+int UnloadLayer (Layer_h layer)
 {
-	if (0 == picture) return 0;
+	Graphics::Main & g = Graphics::Main::Get();
+
+	Graphics::Layer * pLayer = g.mLayers.Get(layer);
 
-	delete static_cast<Graphics::Picture*>(picture);
+	if (0 == pLayer || std::find(g.mTargets.begin(), g.mTargets.end(), pLayer) != g.mTargets.end()) return 0;
+
+	if (g.mDeferring) return PutOff(g, UnloadLayer, layer);
+
+	g.mLayers.Remove(layer);
+
+	delete pLayer;
 
 	return 1;
 }
 
-/// @brief Instantiates a font object
-/// @param name Name of file used to load font data
-/// @param size Size in which to load font
-/// @param font [out] On success, handle to a font object
+/// @brief Selects the backend made when the renderer is set up
+/// @param name Name of backend: "GL" renders through OpenGL; "Record" keeps a list of
+/// commands in memory; "Software" rasterizes on the CPU. Only "GL" needs a GPU
 /// @return 0 on failure, non-0 for success
 /// @note Tested
-int LoadFont (char const * name, int size, Font_h & font)
+int SelectRenderer (char const * name)
 {
 	if (0 == name) return 0;
-	if (0 == font) return 0;
-	if (size <= 0) return 0;
 
 	Graphics::Main & g = Graphics::Main::Get();
 
-	// Load the face if it is not loaded. Acquire the size.
-	if (g.mFaces.find(name) == g.mFaces.end())
-	{
-		g.mFaces[name] = new Graphics::Face(name);
-	}
+	// The backend cannot be swapped out from under loaded resources.
+	if (g.mInit) return 0;
 
-	font = g.mFaces[name]->GetSize(name, size);
+	g.mRenderer = name;
 
 	return 1;
 }
 
-/// @brief Unloads a font object from the renderer
-/// @param font Handle to a font object
+/// @brief Sets whether the backend's commands are carried out on a render thread, while
+/// the next frame is being built
+/// @param bEnable If true, a render thread is used
 /// @return 0 on failure, non-0 for success
 /// @note Tested
-int UnloadFont (Font_h font)
+/// @note Backends whose context cannot change threads carry out each frame when it is
+/// drawn, as without a render thread
+int SetRenderThread (bool bEnable)
 {
-	if (0 == font) return 0;
-
 	Graphics::Main & g = Graphics::Main::Get();
 
-	// Remove the size from the graphics core.
-	FT_Size pSize = static_cast<FT_Size>(font);
-
-	std::map<std::string, Graphics::Face*>::iterator iter = g.mFaces.begin();
-
-	while (iter != g.mFaces.end() && iter->second->mFace != pSize->face) ++iter;
+	// The backend cannot be swapped out from under loaded resources.
+	if (g.mInit) return 0;
 
-	if (iter != g.mFaces.end())
-	{
-		for (std::map<int, FT_Size>::iterator sIter = iter->second->mSizes.begin(); sIter != iter->second->mSizes.end(); ++sIter)
-		{
-			if (sIter->second != pSize) continue;
-			
-            iter->second->mSizes.erase(sIter);
-
-			// If the last size is removed, unload the font itself.
-			if (iter->second->mSizes.empty()) g.mFaces.erase(iter);
-
-			return 1;
-		}
-	}
+	g.mRenderThread = bEnable;
 
-	return 0;
+	return 1;
 }
 
-/// @brief Gets the dimensions of a text string constructed from a given font object
-/// @param font Handle to a font object
-/// @param text Text string whose size is being determined
-/// @param width [out] On success, the string's width
-/// @param height [out] On success, the string's height
+/// @brief Requests that the next frame be written to a PNG file when it is drawn
+/// @param name Name of file to write
 /// @return 0 on failure, non-0 for success
 /// @note Tested
-int GetTextSize (Font_h font, char const * text, int & width, int & height)
+int SaveFrame (char const * name)
 {
-	if (0 == font) return 0;
-	if (0 == text) return 0;
-
-	FT_Size pSize = static_cast<FT_Size>(font);
-
-	FT_Activate_Size(pSize);
-
-	FT_GlyphSlot pSlot = pSize->face->glyph;
-
-	width = 0;
+	if (0 == name) return 0;
 
-	for (Uint32 index = 0; text[index] != '\0'; ++index)
-	{
-		FT_Load_Char(pSize->face, text[index], FT_LOAD_DEFAULT);
+	Graphics::Main & g = Graphics::Main::Get();
 
-		width += pSlot->advance.x;
-	}
+	if (!g.mInit) return 0;
 
-	width /= 64;
-	height = pSize->metrics.height / 64 + 1;
+	g.mBackend->mCapture = name;
 
 	return 1;
 }
 
-/// @brief Generates a renderable text image from a font
-/// @param font Handle to a font object, used to generate the text image
-/// @param text The text to render in the text image
-/// @param color The color of the rendered text image
-/// @param textImage [out] On success, handle to a text image object
+/// @brief Sets the memory budget for image and text image textures
+/// @param bytes Budget, in bytes; if 0, textures are never evicted
+/// @param frames Count of frames a texture must go undrawn before it may be evicted
 /// @return 0 on failure, non-0 for success
 /// @note Tested
-int LoadTextImage (Font_h font, char const * text, SDL_Color color, TextImage_h & textImage)
+/// @note Evicted textures are restored from their sources when next drawn
+int SetTextureBudget (Uint32 bytes, Uint32 frames)
 {
-	if (0 == font) return 0;
-	if (0 == text) return 0;
-	if (0 == textImage) return 0;
-
 	Graphics::Main & g = Graphics::Main::Get();
 
-	try {
-		g.mTextImages.push_back(new Graphics::TextImage(static_cast<FT_Size>(font), text, color));
-	} catch (std::bad_alloc &) {
-		return 0;
-	}
-
-	textImage = g.mTextImages.back();
+	g.mTextureBudget = bytes;
+	g.mEvictAge = std::max(frames, Uint32(1));
 
 	return 1;
 }
 
-/// @brief Renders a text image
-/// @param textImage Handle to a text image object
-/// @param fX Screen x coordinate, in [0, 1]
-/// @param fY Screen y coordinate, in [0, 1]
-/// @param fW Screen width, in [0, 1]
-/// @param fH Screen height, in [0, 1]
+/// @brief Sets whether only the parts of the screen that changed since the last frame are
+/// repainted. Calls made to the screen are then put off until DrawFrame, which compares
+/// them with those of the last frame and replays them within the rectangles they differ
+/// @param bEnable If true, damage is tracked; otherwise, every frame is drawn in full
 /// @return 0 on failure, non-0 for success
 /// @note Tested
-int DrawTextImage (TextImage_h textImage, float fX, float fY, float fW, float fH)
+/// @note Backends that do not keep the screen between frames keep it in a layer, so damage
+/// is only tracked if they can render into textures. Calls are carried out with pictures and
+/// nine-slices as they stand when the frame is drawn, and unloads made while calls are put
+/// off wait until then
+int SetDamageTracking (bool bEnable)
 {
-	if (0 == textImage) return 0;
-
 	Graphics::Main & g = Graphics::Main::Get();
 
-	// Transform the provided coordinates and dimensions into a form OpenGL expects, and
-	// scale them to the current resolution.
-	float fSX = fX;
-	float fEX = fX + fW;
-	float fSY = 1.0f - fY - fH;
-	float fEY = 1.0f - fY;
-
-	fSX *= g.mResW;
-	fEX *= g.mResW;
-	fSY *= g.mResH;
-	fEY *= g.mResH;
+	g.mDamageTracking = bEnable;
+	g.mRepaintAll = true;
 
-	// Convert the handle to a usable form. Set OpenGL up to render the text image's
-	// texture, and draw a quad with the requested properties.
-	Graphics::TextImage * Text = static_cast<Graphics::TextImage*>(textImage);
+	return 1;
+}
 
-	glEnable(GL_TEXTURE_2D);
-	glBindTexture(GL_TEXTURE_2D, Text->mTexture);
+/// @brief Sets whether fonts draw from distance fields, baked once per face, instead of
+/// rasterizing glyphs at each size
+/// @param size Size at which distance fields are baked, or 0 to rasterize every size
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+/// @note Sizes loaded afterward are affected; those already loaded keep their glyphs
+int SetDistanceFieldFonts (int size)
+{
+	if (size < 0) return 0;
 
-	glBegin(GL_QUADS);
-		glTexCoord2f(0.0f, Text->mT);		glVertex2f(fSX, fSY);
-		glTexCoord2f(Text->mS, Text->mT);	glVertex2f(fEX, fSY);
-		glTexCoord2f(Text->mS, 0.0f);		glVertex2f(fEX, fEY);
-		glTexCoord2f(0.0f, 0.0f);			glVertex2f(fSX, fEY);
-	glEnd();
+	Graphics::Main::Get().mFieldSize = size;
 
 	return 1;
 }
 
-/// @brief Unloads a text image object from the renderer
-/// @param textImage Handle to a text image object
+/// @brief Sets the directory in which decoded images are cached, keyed by the name, size,
+/// and modification time of their files, so that later loads map the pixels rather than
+/// decoding them
+/// @param dir Name of directory, made if missing, or 0 or empty to always decode
 /// @return 0 on failure, non-0 for success
 /// @note Tested
-int UnloadTextImage (TextImage_h textImage)
+int SetImageCache (char const * dir)
 {
-	if (0 == textImage) return 0;
+	Graphics::Main & g = Graphics::Main::Get();
+
+	g.mImageCache.clear();
+
+	if (0 == dir || '\0' == *dir) return 1;
+
+	if (!Graphics::MakeCacheDir(dir)) return 0;
 
-	delete static_cast<Graphics::TextImage*>(textImage);
+	g.mImageCache = dir;
 
 	return 1;
 }
 
-/// @brief Renders a square, unfilled box in the given color
-/// @param fX Screen x coordinate, in [0, 1]
-/// @param fY Screen y coordinate, in [0, 1]
-/// @param fW Screen width, in [0, 1]
-/// @param fH Screen height, in [0, 1]
-/// @param fR Red value, in [0, 1]
-/// @param fG Green value, in [0, 1]
-/// @param fB Blue value, in [0, 1]
+/// @brief Sets the asset pack searched for image and font files before they are read from
+/// disk, e.g. one built by PackTool
+/// @param name Name of pack file, or 0 or empty to read every file from disk
 /// @return 0 on failure, non-0 for success
 /// @note Tested
-int DrawBox (float fX, float fY, float fW, float fH, float fR, float fG, float fB)
+/// @note Loaded images and fonts read from the pack in place, so it may not be changed
+/// while the system is initialized
+int SetAssetPack (char const * name)
 {
 	Graphics::Main & g = Graphics::Main::Get();
 
-	// Transform the provided coordinates and dimensions into a form OpenGL expects, and
-	// scale them to the current resolution.
-	float fSX = floorf(fX * g.mResW);
-	float fSY = floorf((1.0f - fY - fH) * g.mResH);
-	float fEX = fSX + floorf(fW * g.mResW - 0.5f);
-	float fEY = fSY + floorf(fH * g.mResH - 0.5f);
-
-	// Turn off texturing and switch to the desired color. Draw an unfilled box.
-	glDisable(GL_TEXTURE_2D);
-	
-	GLfloat color[4];	glGetFloatv(GL_CURRENT_COLOR, color);
-	glColor3f(fR, fG, fB);
+	if (g.mInit) return 0;
 
-	glBegin(GL_LINE_LOOP);
-		glVertex2f(fSX, fSY);
-		glVertex2f(fEX, fSY);
-		glVertex2f(fEX, fEY);
-		glVertex2f(fSX, fEY);
-	glEnd();
+	g.mPack.Close();
 
-	glColor4fv(color);
+	if (0 == name || '\0' == *name) return 1;
 
-	return 1;
+	return g.mPack.Open(name) ? 1 : 0;
 }
 
-/// @brief Renders a line in the given color
-/// @param fSX Screen start x coordinate, in [0, 1]
-/// @param fSY Screen start y coordinate, in [0, 1]
-/// @param fEX Screen end x coordinate, in [0, 1]
-/// @param fEY Screen end y coordinate, in [0, 1]
-/// @param fR Red value, in [0, 1]
-/// @param fG Green value, in [0, 1]
-/// @param fB Blue value, in [0, 1]
+/// @brief Sets a function called whenever an image loading in the background has been
+/// decoded, e.g. to request a frame in which to place it
+/// @param func Function to call, or 0 for none
 /// @return 0 on failure, non-0 for success
 /// @note Tested
-int DrawLine (float fSX, float fSY, float fEX, float fEY, float fR, float fG, float fB)
+/// @note The function is called on a decoding thread
+int SetLoadCallback (void (*func)(void))
 {
 	Graphics::Main & g = Graphics::Main::Get();
 
-	// Turn off texturing and switch to the desired color. Draw a line.
-	glDisable(GL_TEXTURE_2D);
-	
-	GLfloat color[4];	glGetFloatv(GL_CURRENT_COLOR, color);
-	glColor3f(fR, fG, fB);
+	if (g.mDecoder.mLock != 0) SDL_mutexP(g.mDecoder.mLock);
 
-	glBegin(GL_LINES);
-		glVertex2f(fSX * g.mResW, (1.0f - fSY) * g.mResH);
-		glVertex2f(fEX * g.mResW, (1.0f - fEY) * g.mResH);
-	glEnd();
+	g.mDecoder.mNotify = func;
 
-	glColor4fv(color);
+	if (g.mDecoder.mLock != 0) SDL_mutexV(g.mDecoder.mLock);
 
 	return 1;
 }
 
-/// @brief Renders a square, unfilled grid in the current color
-/// @param fX Screen x coordinate, in [0, 1]
-/// @param fY Screen y coordinate, in [0, 1]
-/// @param fW Screen width, in [0, 1]
-/// @param fH Screen height, in [0, 1]
-/// @param fR Red value, in [0, 1]
-/// @param fG Green value, in [0, 1]
-/// @param fB Blue value, in [0, 1]
-/// @param xCuts Number of horizontal partitions
-/// @param yCuts Number of vertical partitions
+/// @brief Gets the render statistics for the last completed frame
+/// @param stats [out] On success, the statistics
 /// @return 0 on failure, non-0 for success
 /// @note Tested
-int DrawGrid (float fX, float fY, float fW, float fH, float fR, float fG, float fB, Uint32 xCuts, Uint32 yCuts)
+int GetRenderStats (RenderStats & stats)
 {
 	Graphics::Main & g = Graphics::Main::Get();
 
-	// Transform the provided coordinates and dimensions into a form OpenGL expects, and
-	// scale them to the current resolution.
-	float fSX = floorf(fX * g.mResW);
-	float fSY = floorf((1.0f - fY - fH) * g.mResH);
-	float fEX = fSX + floorf(fW * g.mResW - 0.5f);
-	float fEY = fSY + floorf(fH * g.mResH - 0.5f);
-
-	// Turn off texturing and switch to the desired color.
-	glDisable(GL_TEXTURE_2D);
+	if (!g.mInit) return 0;
 
-	GLfloat color[4];	glGetFloatv(GL_CURRENT_COLOR, color);
-	glColor3f(fR, fG, fB);
+	stats = g.mBackend->mLastStats;
 
-	// Draw the horizontal and vertical lines.
-	glBegin(GL_LINES);
-		float fDW = (fEX - fSX) / (xCuts + 1);
+	return 1;
+}
 
-		for (fX = fSX + fDW; xCuts-- != 0; fX += fDW)
-		{
-			glVertex2f(fX, fSY);
-			glVertex2f(fX, fEY);
-		}
+/// @brief Writes the commands of the last completed frame to a file
+/// @param name Name of file to write
+/// @return 0 on failure, non-0 for success
+/// @note Tested
+/// @note Only backends that keep commands, i.e. "Record", can be dumped
+int DumpRenderCommands (char const * name)
+{
+	if (0 == name) return 0;
 
-		float fDH = (fEY - fSY) / (yCuts + 1);
+	Graphics::Main & g = Graphics::Main::Get();
 
-		for (fY = fSY + fDH; yCuts-- != 0; fY += fDH)
-		{
-			glVertex2f(fSX, fY);
-			glVertex2f(fEX, fY);
-		}
-	glEnd();
+	if (!g.mInit) return 0;
 
-	// Draw an unfilled box.
-	glBegin(GL_LINE_LOOP);
-		glVertex2f(fSX, fSY);
-		glVertex2f(fEX, fSY);
-		glVertex2f(fEX, fEY);
-		glVertex2f(fSX, fEY);
-	glEnd();
+	std::ofstream file(name);
 
-	glColor4fv(color);
+	if (!file) return 0;
 
-	return 1;
+	return g.mBackend->Dump(file) ? 1 : 0;
 }
 
 /// @brief Indicates whether the graphics system is initialized
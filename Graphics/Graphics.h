@@ -4,10 +4,18 @@
 #include <SDL/SDL_types.h>
 #include <SDL/SDL_video.h>
 
+// windows.h defines DrawText as a macro; keep the renderer's name intact.
+#ifdef DrawText
+#undef DrawText
+#endif
+
 /* Graphics */
 typedef void * Picture_h;
 typedef void * Font_h;
 typedef void * TextImage_h;
+typedef void * NineSlice_h;
+typedef void * Block_h;
+typedef void * Layer_h;
 
 int SetupGraphics (int width, int height, int bpp, bool bFullscreen);
 int CloseGraphics (void);
@@ -16,20 +24,79 @@ int GetVideoSize (Uint32 & width, Uint32 & height);
 int PrepareFrame (void);
 int DrawFrame (void);
 int SetBounds (float fX, float fY, float fW, float fH);
+int PushBounds (float fX, float fY, float fW, float fH);
+int PopBounds (void);
 int LoadPicture (char const * name, float fS0, float fT0, float fS1, float fT1, Picture_h & picture);
+int LoadPictureAsync (char const * name, float fS0, float fT0, float fS1, float fT1, Picture_h & picture);
+int LoadThumbnail (char const * name, int size, float fS0, float fT0, float fS1, float fT1, Picture_h & picture);
+int IsPictureReady (Picture_h picture, bool & bReady);
+int GetPendingLoads (Uint32 & decoding, Uint32 & ready);
 int DrawPicture (Picture_h picture, float fX, float fY, float fW, float fH);
+int DrawPictureEx (Picture_h picture, float fX, float fY, float fW, float fH, bool bFlipH, bool bFlipV);
 int SetPictureTexels (Picture_h picture, float fS0, float fT0, float fS1, float fT1);
 int GetPictureTexels (Picture_h picture, float & fS0, float & fT0, float & fS1, float & fT1);
 int UnloadPicture (Picture_h picture);
 int LoadFont (char const * name, int size, Font_h & font);
 int UnloadFont (Font_h font);
 int GetTextSize (Font_h font, char const * text, int & width, int & height);
+int GetTextWidths (Font_h font, char const * text, int * widths);
 int LoadTextImage (Font_h font, char const * text, SDL_Color color, TextImage_h & textImage);
 int DrawTextImage (TextImage_h textImage, float fX, float fY, float fW, float fH);
 int UnloadTextImage (TextImage_h textImage);
+int DrawText (Font_h font, char const * text, float fX, float fY, SDL_Color color);
 int DrawBox (float fX, float fY, float fW, float fH, float fR, float fG, float fB);
 int DrawLine (float fSX, float fSY, float fEX, float fEY, float fR, float fG, float fB);
 int DrawGrid (float fX, float fY, float fW, float fH, float fR, float fG, float fB, Uint32 xCuts, Uint32 yCuts);
+int LoadNineSlice (NineSlice_h & nineSlice);
+int SetNineSliceCell (NineSlice_h nineSlice, int cell, Picture_h picture, bool bFlipH, bool bFlipV);
+int SetNineSliceThresholds (NineSlice_h nineSlice, float fStretchW, float fStretchH);
+int DrawNineSlice (NineSlice_h nineSlice, float fX, float fY, float fW, float fH, bool bIgnore);
+int UnloadNineSlice (NineSlice_h nineSlice);
+int LoadBlock (Block_h & block);
+int BeginBlock (Block_h block);
+int EndBlock (void);
+int DrawBlock (Block_h block, float fX, float fY);
+int UnloadBlock (Block_h block);
+int LoadLayer (Layer_h & layer);
+int BeginLayer (Layer_h layer, float fX, float fY, float fW, float fH);
+int EndLayer (void);
+int DrawLayer (Layer_h layer, float fX, float fY);
+int UnloadLayer (Layer_h layer);
+
+/* Render statistics for the last completed frame */
+typedef struct {
+	Uint32 mDrawCalls;	///< Draw calls submitted
+	Uint32 mVertices;	///< Vertices submitted
+	Uint32 mTextureBinds;	///< Texture binds, including switches to untextured drawing
+	Uint32 mScissors;	///< Scissor changes
+	Uint32 mClears;	///< Clears
+	Uint32 mTextureUploads;	///< Texture creations and updates
+	Uint32 mStateChanges;	///< Device state changes issued
+	Uint32 mStateSkips;	///< Device state changes skipped as redundant
+	Uint32 mTextureHits;	///< Image and text image draws whose texture was resident
+	Uint32 mTextureMisses;	///< Image and text image draws whose texture had to be restored
+	Uint32 mTextureEvictions;	///< Textures evicted to stay within the texture budget
+	Uint32 mTextureBytes;	///< Bytes of image and text image textures resident at the end of the frame
+	Uint32 mCulledQuads;	///< Quads skipped as lying wholly outside the bounds
+	Uint32 mCulledLines;	///< Lines skipped as lying wholly outside the bounds
+	Uint32 mTargetSwitches;	///< Render target changes, between the screen and layers
+	Uint32 mLayerRenders;	///< Layers rendered anew
+	Uint32 mDamagedPixels;	///< Screen pixels repainted; all of them unless damage is tracked
+	Uint32 mImagesPlaced;	///< Images loaded asynchronously and placed in the atlas
+	Uint32 mTilesDrawn;	///< Tiles of images too large for the atlas drawn
+} RenderStats;
+
+int SelectRenderer (char const * name);
+int SetRenderThread (bool bEnable);
+int SaveFrame (char const * name);
+int SetTextureBudget (Uint32 bytes, Uint32 frames);
+int SetDamageTracking (bool bEnable);
+int SetDistanceFieldFonts (int size);
+int SetImageCache (char const * dir);
+int SetAssetPack (char const * name);
+int SetLoadCallback (void (*func)(void));
+int GetRenderStats (RenderStats & stats);
+int DumpRenderCommands (char const * name);
 
 bool GraphicsWasInit (void);
 
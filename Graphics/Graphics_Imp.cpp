@@ -3,28 +3,37 @@
 
 #include "Graphics_Imp.h"
 #include "Graphics.h"
+#include <SDL/SDL_mutex.h>
+#include <SDL/SDL_thread.h>
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstring>
+#include <iostream>
 
 namespace Graphics
 {
-	/// @var c_Rmask
-	/// @brief Red mask constant
-	static Uint32 const c_Rmask = SDL_BYTEORDER == SDL_BIG_ENDIAN ? 0xFF000000 : 0x000000FF;
-	/// @var c_Gmask
-	/// @brief Green mask constant
-	static Uint32 const c_Gmask = SDL_BYTEORDER == SDL_BIG_ENDIAN ? 0x00FF0000 : 0x0000FF00;
-	/// @var c_Bmask
-	/// @brief Blue mask constant
-	static Uint32 const c_Bmask = SDL_BYTEORDER == SDL_BIG_ENDIAN ? 0x0000FF00 : 0x00FF0000;
-	/// @var c_Amask
-	/// @brief Alpha mask constant
-	static Uint32 const c_Amask = SDL_BYTEORDER == SDL_BIG_ENDIAN ? 0x000000FF : 0xFF000000;
+	/// @var c_ImagePageSize
+	/// @brief Width and height of an ordinary image atlas page
+	static GLsizei const c_ImagePageSize = 1024;
+
+	/// @var c_GlyphPageSize
+	/// @brief Width and height of an ordinary glyph atlas page
+	static GLsizei const c_GlyphPageSize = 512;
+
+	/// @var c_FieldThreads
+	/// @brief Count of threads, including the caller, that compute distance fields
+	static int const c_FieldThreads = 4;
+
+	/// @var c_Far
+	/// @brief Squared distance standing in for infinity in distance transforms
+	static float const c_Far = 1e20f;
 
 	/// @brief Gets the next power-of-2 value
 	/// @param num Number to increase
 	/// @return Power-of-2 value greater than or equal to num
 	/// @note Tested
-	static int PowerOf2 (int num)
+	int PowerOf2 (int num)
 	{
 		int comp = 1;
 		
@@ -34,56 +43,470 @@ namespace Graphics
 	}
 
 	/// @brief Loads data into a texture
-	/// @param pImage Image data used to build texture
+	/// @param pPixels Pixels used to build texture
+	/// @param w Width of pixels
+	/// @param h Height of pixels
+	/// @param pitch Bytes per row of pixels
+	/// @param format Texel format of pixels
+	/// @param fS [out] Texture s-extent covered by the pixels
+	/// @param fT [out] Texture t-extent covered by the pixels
 	/// @return Generated texture
 	/// @note Tested
-	static GLuint LoadTexture (SDL_Surface * pImage)
+	static GLuint LoadTexture (void const * pPixels, GLsizei w, GLsizei h, GLsizei pitch, GLenum format, GLfloat & fS, GLfloat & fT)
+	{
+		// Make a texture just big enough for the pixels, padded out to power-of-2 sizes if
+		// the device needs them, and upload only the pixels themselves.
+		Backend * pBackend = Main::Get().mBackend;
+
+		GLsizei texW = pBackend->FitTexture(w), texH = pBackend->FitTexture(h);
+
+		GLuint texture = pBackend->CreateTexture(texW, texH, format);
+
+		pBackend->UpdateTexture(texture, 0, 0, w, h, pitch, pPixels);
+
+		// Clear the padding next to the pixels, so that filtering at the edges sees only
+		// transparent texels there.
+		std::vector<Uint32> clear(std::max(w, h) + 1, 0);
+
+		GLsizei size = Backend::TexelSize(format);
+
+		if (texW > w) pBackend->UpdateTexture(texture, w, 0, 1, std::min(h + 1, texH), size, &clear[0]);
+		if (texH > h) pBackend->UpdateTexture(texture, 0, h, w, 1, w * size, &clear[0]);
+
+		fS = GLfloat(w) / texW;
+		fT = GLfloat(h) / texH;
+
+		return texture;
+	}
+
+	/// @brief Glyph awaiting its distance field
+	struct FieldJob {
+		FT_ULong mCode;	///< Character code of glyph
+		Glyph mGlyph;	///< Glyph placement, less its page and texture coordinates
+		std::vector<Uint8> mTexels;	///< Coverage, replaced by the distance field
+	};
+
+	/// @brief Set of glyphs shared among the threads computing their distance fields
+	struct FieldWork {
+		std::vector<FieldJob> * mJobs;	///< Glyphs to process
+		SDL_mutex * mLock;	///< Lock guarding the next index
+		size_t mNext;	///< Index of next glyph to take
+		int mSpread;///< Reach of distance fields, in pixels
+	};
+
+	/// @brief Computes the squared distance transform of a sampled function in one dimension
+	/// @param f Function samples, i.e. 0 at sites and c_Far elsewhere; replaced by the result
+	/// @param n Sample count
+	/// @param d Scratch storage for n samples
+	/// @param v Scratch storage for n parabola indices
+	/// @param z Scratch storage for n + 1 parabola boundaries
+	/// @note Tested
+	/// @note This is Felzenszwalb and Huttenlocher's lower envelope of parabolas
+	static void Transform (float * f, int n, float * d, int * v, float * z)
 	{
-		// OpenGL will be used in RGBA mode; thus, power-of-2, RGBA textures are needed.
-		// Convert the image to the nearest fit if necessary, freeing the old surface.
-		int w = PowerOf2(pImage->w), h = PowerOf2(pImage->h);
+		// Build the lower envelope of the parabolas rooted at each sample.
+		int k = 0;
 
-		if (w != pImage->w || h != pImage->h || pImage->format->BytesPerPixel != 4)
+		v[0] = 0;
+		z[0] = -c_Far;
+		z[1] = +c_Far;
+
+		for (int q = 1; q < n; ++q)
 		{
-			SDL_Surface * pOld = pImage;
+			float s;
+
+			while ((s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k])) <= z[k] && k > 0) --k;
+
+			v[++k] = q;
+			z[k] = s;
+			z[k + 1] = +c_Far;
+		}
 
-			pImage = SDL_CreateRGBSurface(0, w, h, 32, c_Rmask, c_Gmask, c_Bmask, c_Amask);
+		// Read off the envelope at each sample.
+		for (int q = 0, k = 0; q < n; ++q)
+		{
+			while (z[k + 1] < q) ++k;
 
-			SDL_BlitSurface(pOld, 0, pImage, 0);
-			SDL_FreeSurface(pOld);
+			d[q] = float((q - v[k]) * (q - v[k])) + f[v[k]];
 		}
 
-		// Load the image data into the texture. Assign some properties and return it.
-		GLuint texture;
+		std::copy(d, d + n, f);
+	}
 
-		glGenTextures(1, &texture);
-		glBindTexture(GL_TEXTURE_2D, texture);
-		glTexImage2D(GL_TEXTURE_2D, 0, 4, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, pImage->pixels);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	/// @brief Computes the squared distance transform of a grid, column by column and
+	/// then row by row
+	/// @param grid Grid samples, i.e. 0 at sites and c_Far elsewhere; replaced by the result
+	/// @param w Grid width
+	/// @param h Grid height
+	/// @note Tested
+	static void Transform (std::vector<float> & grid, int w, int h)
+	{
+		int n = std::max(w, h);
 
-		SDL_FreeSurface(pImage);
+		std::vector<float> f(n), d(n), z(n + 1);
+		std::vector<int> v(n);
 
-		return texture;
+		for (int x = 0; x < w; ++x)
+		{
+			for (int y = 0; y < h; ++y) f[y] = grid[y * w + x];
+
+			Transform(&f[0], h, &d[0], &v[0], &z[0]);
+
+			for (int y = 0; y < h; ++y) grid[y * w + x] = f[y];
+		}
+
+		for (int y = 0; y < h; ++y) Transform(&grid[y * w], w, &d[0], &v[0], &z[0]);
+	}
+
+	/// @brief Replaces a glyph's coverage by its signed distance field
+	/// @param job Glyph to process
+	/// @param spread Reach of the field, in pixels
+	/// @note Tested
+	/// @note The field is 0x80 along the glyph's edges, rising inside and falling outside,
+	/// and saturates one spread away
+	static void MakeField (FieldJob & job, int spread)
+	{
+		int w = job.mGlyph.mW, h = job.mGlyph.mH;
+
+		// Find each texel's distance to the nearest texel on the other side of the edge.
+		std::vector<float> outside(w * h), inside(w * h);
+
+		for (int index = 0; index < w * h; ++index)
+		{
+			bool bInside = job.mTexels[index] >= 0x80;
+
+			outside[index] = bInside ? 0.0f : c_Far;
+			inside[index] = bInside ? c_Far : 0.0f;
+		}
+
+		Transform(outside, w, h);
+		Transform(inside, w, h);
+
+		for (int index = 0; index < w * h; ++index)
+		{
+			float fDist = sqrtf(outside[index]) - sqrtf(inside[index]);
+			float fValue = 0.5f - fDist / (2 * spread);
+
+			job.mTexels[index] = Uint8(std::min(std::max(fValue, 0.0f), 1.0f) * 255.0f + 0.5f);
+		}
+	}
+
+	/// @brief Computes distance fields until none remain
+	/// @param pData Work shared among the threads
+	/// @return 0
+	/// @note Tested
+	static int FieldWorker (void * pData)
+	{
+		FieldWork * pWork = static_cast<FieldWork*>(pData);
+
+		for (;;)
+		{
+			SDL_mutexP(pWork->mLock);
+
+			size_t index = pWork->mNext++;
+
+			SDL_mutexV(pWork->mLock);
+
+			if (index >= pWork->mJobs->size()) return 0;
+
+			MakeField((*pWork->mJobs)[index], pWork->mSpread);
+		}
 	}
 
 	/// @var G_Main
 	/// @brief Graphics manager singleton
 	Main G_Main;
 
+	/// @brief Constructs a Batch object
+	/// @note Tested
+	Batch::Batch (void) : mTexture(0), mMode(GL_QUADS), mShade(eBlend)
+	{
+		mClip[0] = mClip[1] = mClip[2] = mClip[3] = 0.0f;
+	}
+
+	/// @brief Adds a line to the batch
+	/// @param fSX Start x coordinate, in pixels
+	/// @param fSY Start y coordinate, in pixels
+	/// @param fEX End x coordinate, in pixels
+	/// @param fEY End y coordinate, in pixels
+	/// @param color RGBA color of line
+	/// @note Tested
+	void Batch::AddLine (GLfloat fSX, GLfloat fSY, GLfloat fEX, GLfloat fEY, GLubyte const * color)
+	{
+		Vertex vertex = { fSX, fSY, 0.0f, 0.0f };
+
+		std::copy(color, color + 4, vertex.mColor);
+
+		mVertices.push_back(vertex);
+
+		vertex.mX = fEX;
+		vertex.mY = fEY;
+
+		mVertices.push_back(vertex);
+	}
+
+	/// @brief Adds a quad to the batch
+	/// @param fSX Start x coordinate, in pixels
+	/// @param fSY Start y coordinate, in pixels
+	/// @param fEX End x coordinate, in pixels
+	/// @param fEY End y coordinate, in pixels
+	/// @param fS0 Texture s-coordinate at start x
+	/// @param fT0 Texture t-coordinate at start y
+	/// @param fS1 Texture s-coordinate at end x
+	/// @param fT1 Texture t-coordinate at end y
+	/// @param color RGBA color used to modulate quad
+	/// @note Tested
+	void Batch::AddQuad (GLfloat fSX, GLfloat fSY, GLfloat fEX, GLfloat fEY, GLfloat fS0, GLfloat fT0, GLfloat fS1, GLfloat fT1, GLubyte const * color)
+	{
+		Vertex corners[4] = {
+			{ fSX, fSY, fS0, fT0 },
+			{ fEX, fSY, fS1, fT0 },
+			{ fEX, fEY, fS1, fT1 },
+			{ fSX, fEY, fS0, fT1 }
+		};
+
+		for (int index = 0; index < 4; ++index)
+		{
+			std::copy(color, color + 4, corners[index].mColor);
+
+			mVertices.push_back(corners[index]);
+		}
+	}
+
+	/// @brief Indicates whether lines lie wholly outside the scissor rectangle
+	/// @param fSX Left edge of the lines' bounding box, in pixels
+	/// @param fSY Bottom edge of the lines' bounding box, in pixels
+	/// @param fEX Right edge of the lines' bounding box, in pixels
+	/// @param fEY Top edge of the lines' bounding box, in pixels
+	/// @param count Count of lines in the box
+	/// @return If true, the lines may be skipped
+	/// @note Tested
+	bool Batch::CullLines (GLfloat fSX, GLfloat fSY, GLfloat fEX, GLfloat fEY, Uint32 count)
+	{
+		// Lines rasterize up to a pixel to either side, so allow some slack.
+		if (fEX + 1.0f >= mClip[0] && fSX - 1.0f <= mClip[2] && fEY + 1.0f >= mClip[1] && fSY - 1.0f <= mClip[3]) return false;
+
+		G_Main.mBackend->mStats.mCulledLines += count;
+
+		return true;
+	}
+
+	/// @brief Indicates whether quads lie wholly outside the scissor rectangle
+	/// @param fSX Left edge of the quads' bounding box, in pixels
+	/// @param fSY Bottom edge of the quads' bounding box, in pixels
+	/// @param fEX Right edge of the quads' bounding box, in pixels
+	/// @param fEY Top edge of the quads' bounding box, in pixels
+	/// @param count Count of quads in the box
+	/// @return If true, the quads may be skipped
+	/// @note Tested
+	bool Batch::CullQuads (GLfloat fSX, GLfloat fSY, GLfloat fEX, GLfloat fEY, Uint32 count)
+	{
+		if (InClip(fSX, fSY, fEX, fEY)) return false;
+
+		G_Main.mBackend->mStats.mCulledQuads += count;
+
+		return true;
+	}
+
+	/// @brief Submits all pending primitives to the backend
+	/// @note Tested
+	void Batch::Flush (void)
+	{
+		if (mVertices.empty()) return;
+
+		// Draw the whole run at once.
+		G_Main.mBackend->Draw(mMode, mTexture, &mVertices[0], GLsizei(mVertices.size()), mShade);
+
+		mVertices.clear();
+	}
+
+	/// @brief Indicates whether a box overlaps the scissor rectangle
+	/// @param fSX Left edge of box, in pixels
+	/// @param fSY Bottom edge of box, in pixels
+	/// @param fEX Right edge of box, in pixels
+	/// @param fEY Top edge of box, in pixels
+	/// @return If true, the box overlaps the scissor rectangle
+	/// @note Tested
+	bool Batch::InClip (GLfloat fSX, GLfloat fSY, GLfloat fEX, GLfloat fEY) const
+	{
+		return fEX > mClip[0] && fSX < mClip[2] && fEY > mClip[1] && fSY < mClip[3];
+	}
+
+	/// @brief Readies the batch to accept primitives with the given properties
+	/// @param texture Texture used by the primitives, or 0 if untextured
+	/// @param mode Primitive type
+	/// @param shade Blending of the primitives
+	/// @note Tested
+	void Batch::Prepare (GLuint texture, GLenum mode, Shade shade)
+	{
+		// Primitives that cannot join the current run force a flush.
+		if (texture != mTexture || mode != mMode || shade != mShade) Flush();
+
+		mTexture = texture;
+		mMode = mode;
+		mShade = shade;
+	}
+
 	/// @brief Constructs an Image object
 	/// @param name Name of file used to load image
+	/// @param bAsync If true, the image is decoded on a worker thread and placed once ready
+	/// @param thumbnail If non-0, size toward which the image is halved, for a thumbnail
 	/// @note Tested
-	Image::Image (std::string const & name) : mCount(0)
+	Image::Image (std::string const & name, bool bAsync, GLsizei thumbnail) : mPage(0), mJob(0), mSource(0), mS0(0.0f), mS1(0.0f), mT0(0.0f), mT1(0.0f), mX(0), mY(0), mW(0), mH(0), mThumbnail(thumbnail), mName(name), mCount(0)
 	{
-		// Attempt to load the image data, given the filename.
-		SDL_Surface * pImage = IMG_Load(name.c_str());
+		// Hand the image to the decoder, if asked; it stays empty until placed.
+		if (bAsync)
+		{
+			mJob = new DecodeJob(this);
 
-		if (0 == pImage) throw std::bad_alloc();
+			if (G_Main.mDecoder.Add(mJob)) return;
 
-		mTexture = LoadTexture(pImage);
+			delete mJob;
+
+			mJob = 0;
+		}
+
+		// Attempt to load the image data in RGBA form, given the filename, and place it.
+		ImageData * pData = new ImageData;
+
+		if (!pData->Load(name))
+		{
+			delete pData;
+
+			throw std::bad_alloc();
+		}
+
+		if (mThumbnail != 0) pData->Reduce(mThumbnail);
+
+		Place(pData);
+	}
+
+	/// @brief Loads the image at once if it is still being decoded, or loads it again if it
+	/// failed to load
+	/// @return If true, the image is placed
+	/// @note Tested
+	bool Image::Finish (void)
+	{
+		if (IsPlaced()) return true;
+
+		// Take over the decode, or wait for the worker running it.
+		if (mJob != 0)
+		{
+			G_Main.mDecoder.Wait(mJob);
+
+			if (mJob->mLoaded)
+			{
+				Place(mJob->mData);
+
+				mJob->mData = 0;
+			}
+
+			delete mJob;
+
+			mJob = 0;
+		}
+
+		else
+		{
+			ImageData * pData = new ImageData;
+
+			if (!pData->Load(mName)) delete pData;
+
+			else
+			{
+				if (mThumbnail != 0) pData->Reduce(mThumbnail);
+
+				Place(pData);
+			}
+		}
+
+		return IsPlaced();
+	}
+
+	/// @brief Indicates whether the image's pixels have been placed
+	/// @return If true, the image is in the atlas or tiled; otherwise, it is loading, or
+	/// failed to load
+	/// @note Tested
+	bool Image::IsPlaced (void) const
+	{
+		return mPage != 0 || mSource != 0;
+	}
+
+	/// @brief Places the image's pixels: packs them into the atlas with a one-texel border,
+	/// or, if they are too large for an ordinary page, keeps them to upload as tiles
+	/// @param data Pixels of image; the image takes ownership of them
+	/// @note Tested
+	/// @note Pixels mapped from the image cache cost little to keep; decoded ones are held
+	/// in memory while the image is loaded
+	void Image::Place (ImageData * data)
+	{
+		mW = data->mW;
+		mH = data->mH;
+
+		if (mW + 2 > c_ImagePageSize || mH + 2 > c_ImagePageSize)
+		{
+			Tile tile = { 0, 0 };
+
+			mTiles.assign(((mW + c_TileSpan - 1) / c_TileSpan) * ((mH + c_TileSpan - 1) / c_TileSpan), tile);
+
+			mSource = data;
+
+			return;
+		}
+
+		mPage = G_Main.mAtlas.InsertExtruded(data->mPixels, mW, mH, data->mPitch, mX, mY);
+
+		mS0 = GLfloat(mX) / mPage->mW;
+		mS1 = GLfloat(mX + mW) / mPage->mW;
+		mT0 = GLfloat(mY) / mPage->mH;
+		mT1 = GLfloat(mY + mH) / mPage->mH;
+
+		delete data;
+	}
+
+	/// @brief Loads the image from its file again and uploads it into its place in its
+	/// page, e.g. after the page was evicted
+	/// @note Tested
+	void Image::Reload (void)
+	{
+		ImageData data;
+
+		bool bLoaded = data.Load(mName);
+
+		if (bLoaded && mThumbnail != 0) data.Reduce(mThumbnail);
+
+		if (bLoaded && data.mW == mW && data.mH == mH) mPage->UploadExtruded(data.mPixels, mW, mH, data.mPitch, mX, mY);
+
+		else std::cerr << "Unable to reload image: " << mName << std::endl;
+	}
+
+	/// @brief Makes a texture for one of the image's tiles, and uploads its pixels into it
+	/// @param index Index of tile
+	/// @note Tested
+	/// @note The border repeats the pixels of the neighboring tiles, or the image's own
+	/// edge pixels along its edges, so that tiles filter seamlessly
+	void Image::UploadTile (Uint32 index)
+	{
+		GLsizei columns = (mW + c_TileSpan - 1) / c_TileSpan;
+		GLint left = GLint(index % columns) * c_TileSpan - 1;
+		GLint top = GLint(index / columns) * c_TileSpan - 1;
+		GLsizei w = std::min(c_TileSize, mW + 1 - left);
+		GLsizei h = std::min(c_TileSize, mH + 1 - top);
+
+		std::vector<Uint32> texels(w * h);
+
+		for (GLint row = 0; row < h; ++row)
+		{
+			Uint8 const * pRow = mSource->mPixels + std::min(std::max(top + row, GLint(0)), GLint(mH - 1)) * mSource->mPitch;
+
+			for (GLint column = 0; column < w; ++column) memcpy(&texels[row * w + column], pRow + std::min(std::max(left + column, GLint(0)), GLint(mW - 1)) * 4, 4);
+		}
+
+		Tile & tile = mTiles[index];
+
+		tile.mTexture = G_Main.mBackend->CreateTexture(c_TileSize, c_TileSize);
+
+		G_Main.mBackend->UpdateTexture(tile.mTexture, 0, 0, w, h, w * 4, &texels[0]);
 	}
 
 	/// @brief Destructs an Image object
@@ -92,17 +515,23 @@ namespace Graphics
 	{
 		assert(0 == mCount);
 
-		glDeleteTextures(1, &mTexture);
+		if (mJob != 0) G_Main.mDecoder.Cancel(mJob);
 
-		// Remove the image from the graphics core.
-		for (std::map<std::string, Image*>::iterator iter = G_Main.mImages.begin(); iter != G_Main.mImages.end(); ++iter)
-		{
-			if (iter->second != this) continue;
+		G_Main.mBatch.Flush();
 
-			G_Main.mImages.erase(iter);
+		if (mPage != 0) G_Main.mAtlas.Release(mPage);
 
-			return;
+		for (std::vector<Tile>::iterator iter = mTiles.begin(); iter != mTiles.end(); ++iter)
+		{
+			if (iter->mTexture != 0) G_Main.mBackend->DeleteTexture(iter->mTexture);
 		}
+
+		delete mSource;
+
+		// Remove the image from the graphics core.
+		if (mThumbnail != 0) G_Main.mThumbnails.erase(std::make_pair(mName, mThumbnail));
+
+		else G_Main.mImages.erase(mName);
 	}
 
 	/// @brief Constructs a Picture object
@@ -122,131 +551,411 @@ namespace Graphics
 		assert(mImage->mCount > 0);
 
 		if (0 == --mImage->mCount) delete mImage;
+	}
+
+	/// @brief Maps the picture's image-relative texels into atlas page space
+	/// @param fS0 [out] Initial s-coordinate within page
+	/// @param fT0 [out] Initial t-coordinate within page
+	/// @param fS1 [out] Terminal s-coordinate within page
+	/// @param fT1 [out] Terminal t-coordinate within page
+	/// @note Tested
+	void Picture::GetAtlasTexels (GLfloat & fS0, GLfloat & fT0, GLfloat & fS1, GLfloat & fT1) const
+	{
+		GLfloat fDS = mImage->mS1 - mImage->mS0;
+		GLfloat fDT = mImage->mT1 - mImage->mT0;
+
+		fS0 = mImage->mS0 + mS0 * fDS;
+		fT0 = mImage->mT0 + mT0 * fDT;
+		fS1 = mImage->mS0 + mS1 * fDS;
+		fT1 = mImage->mT0 + mT1 * fDT;
+	}
+
+	/// @brief Constructs a NineSlice object, empty and stretching above a third of the screen
+	/// @note Tested
+	NineSlice::NineSlice (void) : mStretchW(1.0f / 3), mStretchH(1.0f / 3)
+	{
+		Cell empty = { 0, false, false };
 
-		G_Main.mPictures.remove(this);
+		std::fill(mCells, mCells + 9, empty);
+	}
+
+	/// @brief Constructs a Layer object, not yet rendered
+	/// @note Tested
+	Layer::Layer (void) : mTexture(0), mX(0), mY(0), mW(0), mH(0), mTexW(0), mTexH(0), mRendered(0), mPlaced(0), mMissing(false)
+	{
+	}
+
+	/// @brief Destructs a Layer object
+	/// @note Tested
+	Layer::~Layer (void)
+	{
+		G_Main.mBatch.Flush();
+
+		if (mTexture != 0) G_Main.mBackend->DeleteTexture(mTexture);
 	}
 
 	/// @brief Constructs a Face object
-	/// @param name Name of file used to load face
+	/// @param name Name of face within the core, used to load face
 	/// @note Tested
-	Face::Face (std::string const & name)
+	/// @note The face is read in place, from the asset pack if the pack holds it and
+	/// otherwise from its file mapped into memory
+	Face::Face (std::string const & name) : mName(name), mFace(0), mField(0)
 	{
-		FT_New_Face(G_Main.mFreeType, name.c_str(), 0, &mFace);
+		PackEntry const * pEntry = G_Main.mPack.Find(name);
+
+		Uint8 const * pData = pEntry != 0 ? G_Main.mPack.GetData(pEntry) : 0;
+		size_t size = pEntry != 0 ? pEntry->mSize : 0;
+
+		if (0 == pEntry && mFile.Open(name))
+		{
+			pData = mFile.mData;
+			size = mFile.mSize;
+		}
+
+		if (0 == pData || FT_New_Memory_Face(G_Main.mFreeType, pData, FT_Long(size), 0, &mFace) != 0)
+		{
+			std::cerr << "Unable to load font: " << name << std::endl;
+
+			throw std::bad_alloc();
+		}
 	}
 
 	/// @brief Destructs a Face object
 	/// @note Tested
 	Face::~Face (void)
 	{
+		delete mField;
+
 		FT_Done_Face(mFace);
 	}
 
+	/// @brief Acquires the font holding the face's distance-field glyphs, baking the
+	/// printable ASCII characters on first use
+	/// @return Distance-field font
+	/// @note Tested
+	/// @note The glyphs are baked at the reference size current when the font is made
+	Font * Face::GetField (void)
+	{
+		if (0 == mField)
+		{
+			mField = new Font(this, G_Main.mFieldSize);
+
+			mField->mSpread = std::max(G_Main.mFieldSize / 8, 2);
+
+			std::vector<FT_ULong> codes;
+
+			for (FT_ULong code = ' '; code <= '~'; ++code) codes.push_back(code);
+
+			mField->Bake(codes);
+		}
+
+		return mField;
+	}
+
 	/// @brief Acquires a size from the face
-	/// @param name Name of file used to load face
 	/// @param size Size to obtain
+	/// @return Font of the given size, or 0 if no handle is available for it
 	/// @note Tested
-	FT_Size Face::GetSize (std::string const & name, int size)
+	Font * Face::GetSize (int size)
 	{
 		if (mSizes.find(size) == mSizes.end())
 		{
-			FT_Size Size;	FT_New_Size(mFace, &Size);
+			Font * pFont = new Font(this, size);
 
-			FT_Activate_Size(Size);
-			FT_Set_Pixel_Sizes(mFace, 0, size);
+			// With distance fields on, every size draws the face's one set of glyphs.
+			if (G_Main.mFieldSize != 0) pFont->mField = GetField();
+
+			pFont->mHandle = G_Main.mFonts.Add(pFont);
+
+			if (0 == pFont->mHandle)
+			{
+				delete pFont;
 
-			mSizes[size] = Size;
+				return 0;
+			}
+
+			mSizes[size] = pFont;
+		}
+
+		Font * pFont = mSizes[size];
+
+		++pFont->mCount;
+
+		return pFont;
+	}
+
+	/// @brief Constructs a Font object
+	/// @param face Face from which font is built
+	/// @param size Pixel size of font
+	/// @note Tested
+	Font::Font (Face * face, int size) : mAtlas(c_GlyphPageSize, GL_ALPHA), mFace(face), mField(0), mHandle(0), mCount(0), mPixels(size), mSpread(0)
+	{
+		FT_New_Size(face->mFace, &mSize);
+
+		FT_Activate_Size(mSize);
+		FT_Set_Pixel_Sizes(face->mFace, 0, size);
+
+		std::fill(mAdvances, mAdvances + 256, -1);
+	}
+
+	/// @brief Destructs a Font object
+	/// @note Tested
+	Font::~Font (void)
+	{
+		// Glyph pages are about to go away, so submit anything that uses them.
+		G_Main.mBatch.Flush();
+
+		FT_Done_Size(mSize);
+	}
+
+	/// @brief Acquires a character's advance, measuring it on first use
+	/// @param code Character code
+	/// @return Advance, in 26.6 fixed point
+	/// @note Tested
+	FT_Pos Font::GetAdvance (Uint8 code)
+	{
+		if (mAdvances[code] < 0)
+		{
+			FT_Activate_Size(mSize);
+			FT_Load_Char(mSize->face, code, FT_LOAD_DEFAULT);
+
+			mAdvances[code] = mSize->face->glyph->advance.x;
+		}
+
+		return mAdvances[code];
+	}
+
+	/// @brief Acquires a glyph, rasterizing it into the atlas on first use
+	/// @param code Character code of glyph
+	/// @return Reference to glyph
+	/// @note Tested
+	Glyph const & Font::GetGlyph (FT_ULong code)
+	{
+		std::map<FT_ULong, Glyph>::iterator iter = mGlyphs.find(code);
+
+		if (iter != mGlyphs.end()) return iter->second;
+
+		if (mSpread != 0)
+		{
+			Bake(std::vector<FT_ULong>(1, code));
+
+			return mGlyphs[code];
+		}
+
+		// Render the glyph and record its placement.
+		FT_Activate_Size(mSize);
+		FT_Load_Char(mSize->face, code, FT_LOAD_RENDER);
+
+		FT_GlyphSlot pSlot = mSize->face->glyph;
+		FT_Bitmap const & bitmap = pSlot->bitmap;
+
+		Glyph glyph = { 0 };
+
+		glyph.mLeft = pSlot->bitmap_left;
+		glyph.mTop = pSlot->bitmap_top;
+		glyph.mW = bitmap.width;
+		glyph.mH = bitmap.rows;
+
+		// Copy the coverage rows, leaving a one-texel transparent border, and pack the
+		// result into the alpha atlas. Color is applied when the glyph is drawn.
+		if (glyph.mW > 0 && glyph.mH > 0)
+		{
+			GLsizei w = glyph.mW + 2, h = glyph.mH + 2;
+
+			std::vector<Uint8> texels(w * h, 0);
+
+			for (GLsizei row = 0; row < glyph.mH; ++row)
+			{
+				memcpy(&texels[(row + 1) * w + 1], bitmap.buffer + row * bitmap.pitch, glyph.mW);
+			}
+
+			GLint x, y;
+
+			glyph.mPage = mAtlas.Insert(&texels[0], w, h, w, x, y);
+
+			glyph.mS0 = GLfloat(x + 1) / glyph.mPage->mW;
+			glyph.mS1 = GLfloat(x + 1 + glyph.mW) / glyph.mPage->mW;
+			glyph.mT0 = GLfloat(y + 1) / glyph.mPage->mH;
+			glyph.mT1 = GLfloat(y + 1 + glyph.mH) / glyph.mPage->mH;
 		}
 
-		return mSizes[size];
+		return mGlyphs[code] = glyph;
+	}
+
+	/// @brief Rasterizes glyphs as distance fields and packs them into the atlas
+	/// @param codes Character codes of glyphs; those already baked are skipped
+	/// @note Tested
+	/// @note The fields are computed on several threads at once
+	void Font::Bake (std::vector<FT_ULong> const & codes)
+	{
+		FT_Activate_Size(mSize);
+
+		// Rasterize each glyph with a margin one spread wide, for the field to fall off in.
+		std::vector<FieldJob> jobs;
+
+		for (std::vector<FT_ULong>::const_iterator iter = codes.begin(); iter != codes.end(); ++iter)
+		{
+			if (mGlyphs.find(*iter) != mGlyphs.end() || FT_Load_Char(mSize->face, *iter, FT_LOAD_RENDER) != 0) continue;
+
+			FT_GlyphSlot pSlot = mSize->face->glyph;
+			FT_Bitmap const & bitmap = pSlot->bitmap;
+
+			Glyph glyph = { 0 };
+
+			if (0 == bitmap.width || 0 == bitmap.rows)
+			{
+				mGlyphs[*iter] = glyph;
+
+				continue;
+			}
+
+			glyph.mLeft = pSlot->bitmap_left - mSpread;
+			glyph.mTop = pSlot->bitmap_top + mSpread;
+			glyph.mW = bitmap.width + mSpread * 2;
+			glyph.mH = bitmap.rows + mSpread * 2;
+
+			FieldJob job = { *iter, glyph };
+
+			jobs.push_back(job);
+
+			std::vector<Uint8> & texels = jobs.back().mTexels;
+
+			texels.resize(glyph.mW * glyph.mH, 0);
+
+			for (int row = 0; row < int(bitmap.rows); ++row)
+			{
+				memcpy(&texels[(row + mSpread) * glyph.mW + mSpread], bitmap.buffer + row * bitmap.pitch, bitmap.width);
+			}
+		}
+
+		// Compute the fields, sharing the glyphs out among helper threads and this one.
+		FieldWork work = { &jobs, SDL_CreateMutex(), 0, mSpread };
+
+		std::vector<SDL_Thread*> threads;
+
+		for (size_t index = 1; work.mLock != 0 && index < std::min(jobs.size(), size_t(c_FieldThreads)); ++index)
+		{
+			SDL_Thread * pThread = SDL_CreateThread(FieldWorker, &work);
+
+			if (pThread != 0) threads.push_back(pThread);
+		}
+
+		if (work.mLock != 0) FieldWorker(&work);
+
+		else for (size_t index = 0; index < jobs.size(); ++index) MakeField(jobs[index], mSpread);
+
+		for (size_t index = 0; index < threads.size(); ++index) SDL_WaitThread(threads[index], 0);
+
+		if (work.mLock != 0) SDL_DestroyMutex(work.mLock);
+
+		// Pack the fields into the atlas. Their margins are already clear, so they need no
+		// border.
+		for (std::vector<FieldJob>::iterator iter = jobs.begin(); iter != jobs.end(); ++iter)
+		{
+			Glyph & glyph = iter->mGlyph;
+
+			GLint x, y;
+
+			glyph.mPage = mAtlas.Insert(&iter->mTexels[0], glyph.mW, glyph.mH, glyph.mW, x, y);
+
+			glyph.mS0 = GLfloat(x) / glyph.mPage->mW;
+			glyph.mS1 = GLfloat(x + glyph.mW) / glyph.mPage->mW;
+			glyph.mT0 = GLfloat(y) / glyph.mPage->mH;
+			glyph.mT1 = GLfloat(y + glyph.mH) / glyph.mPage->mH;
+
+			mGlyphs[iter->mCode] = glyph;
+		}
 	}
 
 	/// @brief Constructs a TextImage object
-	/// @param pSize
+	/// @param font
 	/// @param text
 	/// @param color
 	/// @note Tested
-	TextImage::TextImage (FT_Size pSize, std::string const & text, SDL_Color color)
+	TextImage::TextImage (Font * font, std::string const & text, SDL_Color color)
 	{
+		FT_Size pSize = font->mSize;
+
 		FT_Activate_Size(pSize);
 
-		// OpenGL will be used in RGBA mode; thus, power-of-2, RGBA textures are needed. In
-		// addition, properly alpha-blended text images are needed. Convert the image to the
-		// nearest fit and free the old surface.
-		int textW, textH;	GetTextSize(pSize, text.c_str(), textW, textH);
+		// Render the text's coverage into alpha pixels of its own size, kept so that the
+		// texture can be restored after eviction; the texture is padded out, if need be, when
+		// it is loaded. Empty text still gets a texel. Color is applied when the text image
+		// is drawn.
+		int textW, textH;	GetTextSize(font->mHandle, text.c_str(), textW, textH);
 
-		SDL_Surface * pImage = SDL_CreateRGBSurface(0, PowerOf2(textW), PowerOf2(textH), 32, c_Rmask, c_Gmask, c_Bmask, c_Amask);
+		textW = std::max(textW, 1);
+		textH = std::max(textH, 1);
 
-		SDL_SetAlpha(pImage, 0, 0);
+		mPixels.assign(textW * textH, 0);
 
-		//
-		FT_GlyphSlot pSlot = pSize->face->glyph;
+		mW = textW;
+		mH = textH;
 
-		SDL_LockSurface(pImage);
+		mColor[0] = color.r;
+		mColor[1] = color.g;
+		mColor[2] = color.b;
+		mColor[3] = 0xFF;
 
-		Uint8 * pCorner = static_cast<Uint8*>(pImage->pixels);
+		// Render each character at the pen, on a baseline one ascender down, clipping it to
+		// the image. Where characters overlap, the greater coverage is kept.
+		FT_GlyphSlot pSlot = pSize->face->glyph;
+
+		FT_Pos baseline = Ceiling(pSize->metrics.ascender) / 64, pen = 0;
 
 		for (Uint32 index = 0; index < text.size(); ++index)
 		{
-			FT_Load_Char(pSize->face, text[index], FT_LOAD_DEFAULT);
-
-			FT_Glyph Char;	FT_Get_Glyph(pSlot, &Char);
+			if (FT_Load_Char(pSize->face, Uint8(text[index]), FT_LOAD_RENDER) != 0) continue;
 
-			FT_Vector vec = { -pSlot->metrics.horiBearingX, -pSlot->metrics.horiBearingY };
+			FT_Bitmap const & bitmap = pSlot->bitmap;
 
-			FT_Glyph_Transform(Char, 0, &vec);
+			int left = int(pen / 64) + pSlot->bitmap_left, top = int(baseline) - pSlot->bitmap_top;
 
-			FT_Glyph_To_Bitmap(&Char, FT_RENDER_MODE_NORMAL, 0, 1);
-
-			//
-			FT_BitmapGlyph bit = (FT_BitmapGlyph)Char;
+			for (int row = 0; row < int(bitmap.rows); ++row)
+			{
+				if (top + row < 0 || top + row >= textH) continue;
 
-			Uint8 * pLine = pCorner + FT_MulDiv(Ceiling(pSize->metrics.ascender - pSlot->metrics.horiBearingY) - 1, pImage->pitch, 64);
-			Uint8 * pData = bit->bitmap.buffer;
+				int start = std::max(-left, 0), end = std::min(int(bitmap.width), textW - left);
 
-			for (int row = 0; row < bit->bitmap.rows; ++row)
-			{
-				Uint8 * pByte = pLine - FT_MulDiv(vec.x, 4, 64);
-
-				for (int col = 0; col < bit->bitmap.width; ++col)
-				{
-				//	*pByte++ = pData[col];
-				//	*pByte++ = pData[col];
-				//	*pByte++ = pData[col];
-				//	*pByte++ = pData[col] ? 0xFF : 0;
-Uint8 color = pData[col] > 0x40 ? 0xFF : 0;
-					*(Uint32*)pByte = SDL_MapRGBA(pImage->format, color, color, color, color);
-pByte += 4;
-				}
-
-				pLine += pImage->pitch;
-				pData += bit->bitmap.pitch;
+				if (start < end) MergeCoverage(&mPixels[(top + row) * textW + left + start], bitmap.buffer + row * bitmap.pitch + start, end - start);
 			}
 
-			pCorner += FT_MulDiv(bit->root.advance.x, 4, 64);
+			pen += pSlot->advance.x;
 		}
-		
-		SDL_UnlockSurface(pImage);
 
 		// Load the texture and set its extents.
-		mTexture = LoadTexture(pImage);
+		Upload();
 
-		mS = GLfloat(textW) / PowerOf2(textW);
-		mT = GLfloat(textH) / PowerOf2(textH);
+		mUsed = G_Main.mFrame;
 	}
 
 	/// @brief Destructs a TextImage object
 	/// @note Tested
 	TextImage::~TextImage (void)
 	{
-		glDeleteTextures(1, &mTexture);
+		G_Main.mBatch.Flush();
 
-		G_Main.mTextImages.remove(this);
+		if (mTexture != 0) G_Main.mBackend->DeleteTexture(mTexture);
+	}
+
+	/// @brief Loads the text image's pixels into a new texture
+	/// @note Tested
+	void TextImage::Upload (void)
+	{
+		mTexture = LoadTexture(&mPixels[0], mW, mH, mW, GL_ALPHA, mS, mT);
+
+		mBytes = Uint32(G_Main.mBackend->FitTexture(mW) * G_Main.mBackend->FitTexture(mH));
 	}
 
 	/// @brief Constructs the graphics manager
 	/// @note Tested
-	Main::Main (void) : mResW(0), mResH(0)
+	Main::Main (void) : mCanvas(0), mAtlas(c_ImagePageSize), mBackend(0), mRecording(0), mRenderer("GL"), mResW(0), mResH(0), mFrame(0), mPlaced(0), mTextureBudget(0), mEvictAge(60), mFieldSize(0), mDamageTracking(false), mRenderThread(false), mDeferring(false), mRepaintAll(true)
 	{
+		Bounds screen = { 0.0f, 0.0f, 1.0f, 1.0f };
+
+		mBounds.push_back(screen);
+
+		mRepaint.mX0 = mRepaint.mY0 = mRepaint.mX1 = mRepaint.mY1 = 0;
 	}
 
 	/// @brief Destructs the graphics manager
@@ -255,6 +964,259 @@ pByte += 4;
 	{
 	}
 
+	/// @brief Puts the innermost render bounds into force
+	/// @note Tested
+	void Main::ApplyBounds (void)
+	{
+		Bounds const & bounds = mBounds.back();
+
+		float fX = floorf(bounds.mX * mResW), fY = floorf((1.0f - bounds.mY - bounds.mH) * mResH);
+		float fW = ceilf(bounds.mW * mResW), fH = ceilf(bounds.mH * mResH);
+
+		// Confine the bounds to the rectangle being repainted.
+		float fX0 = std::max(fX, float(mRepaint.mX0)), fX1 = std::max(std::min(fX + fW, float(mRepaint.mX1)), fX0);
+		float fY0 = std::max(fY, float(mRepaint.mY0)), fY1 = std::max(std::min(fY + fH, float(mRepaint.mY1)), fY0);
+
+		// Submit anything drawn under the old bounds before they change. Calls put off until
+		// the frame is drawn only need the clip, to find what they touch.
+		mBatch.Flush();
+
+		if (!Deferring()) mBackend->Scissor(GLint(fX0), GLint(fY0), GLsizei(fX1 - fX0), GLsizei(fY1 - fY0));
+
+		mBatch.mClip[0] = fX0;
+		mBatch.mClip[1] = fY0;
+		mBatch.mClip[2] = fX1;
+		mBatch.mClip[3] = fY1;
+	}
+
+	/// @brief Puts the innermost layer being rendered into, or else the screen, into force
+	/// as the render target
+	/// @note Tested
+	void Main::ApplyTarget (void)
+	{
+		// Submit anything drawn into the old target before it changes.
+		mBatch.Flush();
+
+		if (mTargets.empty()) mBackend->SetTarget(0, 0, 0, mResW, mResH);
+
+		else
+		{
+			Layer * pLayer = mTargets.back();
+
+			mBackend->SetTarget(pLayer->mTexture, pLayer->mX, pLayer->mY, pLayer->mW, pLayer->mH);
+		}
+
+		// The scissor rectangle does not survive the change.
+		ApplyBounds();
+	}
+
+	/// @brief Gets the overlap of two sets of bounds
+	/// @param bounds Bounds to narrow
+	/// @param outer Bounds within which the result lies
+	/// @return Overlap, empty if the bounds are disjoint
+	/// @note Tested
+	static Bounds Intersect (Bounds const & bounds, Bounds const & outer)
+	{
+		Bounds inner;
+
+		inner.mX = std::max(bounds.mX, outer.mX);
+		inner.mY = std::max(bounds.mY, outer.mY);
+		inner.mW = std::max(std::min(bounds.mX + bounds.mW, outer.mX + outer.mW) - inner.mX, 0.0f);
+		inner.mH = std::max(std::min(bounds.mY + bounds.mH, outer.mY + outer.mH) - inner.mY, 0.0f);
+
+		return inner;
+	}
+
+	/// @brief Restores the render bounds in force before the last push
+	/// @return If true, bounds were popped
+	/// @note Tested
+	bool Main::PopBounds (void)
+	{
+		// The outermost bounds are only ever replaced.
+		if (mBounds.size() < 2) return false;
+
+		mBounds.pop_back();
+
+		ApplyBounds();
+
+		return true;
+	}
+
+	/// @brief Narrows the render bounds to their overlap with the given bounds
+	/// @param bounds Bounds to intersect with the innermost bounds
+	/// @note Tested
+	void Main::PushBounds (Bounds const & bounds)
+	{
+		mBounds.push_back(Intersect(bounds, mBounds.back()));
+
+		ApplyBounds();
+	}
+
+	/// @brief Replaces the innermost render bounds, keeping them within those enclosing them
+	/// @param bounds Bounds to intersect with the enclosing bounds, if any
+	/// @note Tested
+	void Main::SetBounds (Bounds const & bounds)
+	{
+		mBounds.back() = mBounds.size() > 1 ? Intersect(bounds, mBounds[mBounds.size() - 2]) : bounds;
+
+		ApplyBounds();
+	}
+
+	/// @brief Texture that may be evicted, for ranking by last use
+	struct Resident {
+		Uint32 mUsed;	///< Frame in which texture was last drawn
+		AtlasPage * mPage;	///< Image page holding texture, if any
+		TextImage * mTextImage;	///< Text image holding texture, if any
+		Image::Tile * mTile;///< Tile of an image holding texture, if any
+
+		bool operator < (Resident const & other) const
+		{
+			return mUsed < other.mUsed;
+		}
+	};
+
+	/// @brief Evicts the least recently drawn image pages, image tiles, and text images,
+	/// until their textures fit in the budget or only recently drawn ones remain
+	/// @note Tested
+	/// @note Evicted textures are restored from their sources when next drawn
+	void Main::Evict (void)
+	{
+		std::vector<Resident> candidates;
+
+		Uint32 bytes = 0;
+
+		// Total the resident textures, noting those that have gone undrawn long enough.
+		for (std::list<AtlasPage*>::iterator iter = mAtlas.mPages.begin(); iter != mAtlas.mPages.end(); ++iter)
+		{
+			AtlasPage * pPage = *iter;
+
+			if (0 == pPage->mTexture) continue;
+
+			bytes += Uint32(pPage->mW * pPage->mH * Backend::TexelSize(pPage->mFormat));
+
+			Resident resident = { pPage->mUsed, pPage, 0, 0 };
+
+			if (mFrame - pPage->mUsed >= mEvictAge) candidates.push_back(resident);
+		}
+
+		for (size_t index = 0; index < mTextImages.mSlots.size(); ++index)
+		{
+			TextImage * pText = mTextImages.mSlots[index].mObject;
+
+			if (0 == pText || 0 == pText->mTexture) continue;
+
+			bytes += pText->mBytes;
+
+			Resident resident = { pText->mUsed, 0, pText, 0 };
+
+			if (mFrame - pText->mUsed >= mEvictAge) candidates.push_back(resident);
+		}
+
+		for (std::map<std::string, Image*>::iterator iter = mImages.begin(); iter != mImages.end(); ++iter)
+		{
+			std::vector<Image::Tile> & tiles = iter->second->mTiles;
+
+			for (std::vector<Image::Tile>::iterator tile = tiles.begin(); tile != tiles.end(); ++tile)
+			{
+				if (0 == tile->mTexture) continue;
+
+				bytes += Uint32(c_TileSize * c_TileSize * 4);
+
+				Resident resident = { tile->mUsed, 0, 0, &*tile };
+
+				if (mFrame - tile->mUsed >= mEvictAge) candidates.push_back(resident);
+			}
+		}
+
+		// Evict, oldest first, until back within the budget.
+		if (mTextureBudget != 0 && bytes > mTextureBudget)
+		{
+			std::sort(candidates.begin(), candidates.end());
+
+			for (std::vector<Resident>::iterator iter = candidates.begin(); bytes > mTextureBudget && iter != candidates.end(); ++iter)
+			{
+				GLuint & texture = iter->mPage != 0 ? iter->mPage->mTexture : iter->mTextImage != 0 ? iter->mTextImage->mTexture : iter->mTile->mTexture;
+
+				if (iter->mPage != 0) bytes -= Uint32(iter->mPage->mW * iter->mPage->mH * Backend::TexelSize(iter->mPage->mFormat));
+
+				else bytes -= iter->mTextImage != 0 ? iter->mTextImage->mBytes : Uint32(c_TileSize * c_TileSize * 4);
+
+				mBackend->DeleteTexture(texture);
+
+				texture = 0;
+
+				++mBackend->mStats.mTextureEvictions;
+			}
+		}
+
+		mBackend->mStats.mTextureBytes = bytes;
+	}
+
+	/// @brief Marks an image page as drawn, restoring its texture if it was evicted
+	/// @param page Page being drawn
+	/// @note Tested
+	void Main::Use (AtlasPage * page)
+	{
+		if (page->mTexture != 0) ++mBackend->mStats.mTextureHits;
+
+		// Make a new texture, and reload every image on the page into it.
+		else
+		{
+			++mBackend->mStats.mTextureMisses;
+
+			page->mTexture = mBackend->CreateTexture(page->mW, page->mH, page->mFormat);
+
+			for (std::map<std::string, Image*>::iterator iter = mImages.begin(); iter != mImages.end(); ++iter)
+			{
+				if (iter->second->mPage == page) iter->second->Reload();
+			}
+
+			for (std::map<std::pair<std::string, GLsizei>, Image*>::iterator iter = mThumbnails.begin(); iter != mThumbnails.end(); ++iter)
+			{
+				if (iter->second->mPage == page) iter->second->Reload();
+			}
+		}
+
+		page->mUsed = mFrame;
+	}
+
+	/// @brief Marks a tile of an image as drawn, uploading it if it is not resident
+	/// @param image Tiled image
+	/// @param index Index of tile being drawn
+	/// @note Tested
+	void Main::Use (Image * image, Uint32 index)
+	{
+		Image::Tile & tile = image->mTiles[index];
+
+		if (tile.mTexture != 0) ++mBackend->mStats.mTextureHits;
+
+		else
+		{
+			++mBackend->mStats.mTextureMisses;
+
+			image->UploadTile(index);
+		}
+
+		tile.mUsed = mFrame;
+	}
+
+	/// @brief Marks a text image as drawn, restoring its texture if it was evicted
+	/// @param textImage Text image being drawn
+	/// @note Tested
+	void Main::Use (TextImage * textImage)
+	{
+		if (textImage->mTexture != 0) ++mBackend->mStats.mTextureHits;
+
+		else
+		{
+			++mBackend->mStats.mTextureMisses;
+
+			textImage->Upload();
+		}
+
+		textImage->mUsed = mFrame;
+	}
+
 	/// @brief Accesses the graphics manager singleton
 	/// @return Reference to the graphics manager singleton
 	/// @note Tested
@@ -3,32 +3,611 @@
 
 #include <SDL/SDL_error.h>
 #include <SDL/SDL_image.h>
+#include <SDL/SDL_mutex.h>
 #include <SDL/SDL_opengl.h>
+#include <SDL/SDL_thread.h>
 #include <SDL/SDL_types.h>
 #include <SDL/SDL_video.h>
 #include <ft2build.h>
 #include FT_FREETYPE_H
 #include FT_GLYPH_H
 #include FT_SIZES_H
+#include "Graphics.h"
+#include "Pack.h"
+#include <iosfwd>
 #include <list>
 #include <map>
 #include <string>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define GRAPHICS_SSE2
+	#include <emmintrin.h>
+#endif
 
 namespace Graphics
 {
+	/// @var c_Rmask
+	/// @brief Red mask constant, for RGBA pixels laid out byte by byte
+	static Uint32 const c_Rmask = SDL_BYTEORDER == SDL_BIG_ENDIAN ? 0xFF000000 : 0x000000FF;
+	/// @var c_Gmask
+	/// @brief Green mask constant
+	static Uint32 const c_Gmask = SDL_BYTEORDER == SDL_BIG_ENDIAN ? 0x00FF0000 : 0x0000FF00;
+	/// @var c_Bmask
+	/// @brief Blue mask constant
+	static Uint32 const c_Bmask = SDL_BYTEORDER == SDL_BIG_ENDIAN ? 0x0000FF00 : 0x00FF0000;
+	/// @var c_Amask
+	/// @brief Alpha mask constant
+	static Uint32 const c_Amask = SDL_BYTEORDER == SDL_BIG_ENDIAN ? 0x000000FF : 0xFF000000;
+
+	/// @var c_Unbound
+	/// @brief Texture name used when the bound texture is unknown
+	static GLuint const c_Unbound = ~GLuint(0);
+	/// @var c_TileSize
+	/// @brief Width and height of the texture holding a tile of a large image
+	static GLsizei const c_TileSize = 256;
+	/// @var c_TileSpan
+	/// @brief Width and height of the image covered by a tile, less its border
+	static GLsizei const c_TileSpan = c_TileSize - 2;
+
+	int PowerOf2 (int num);
+	Uint8 const * GetRGBA (SDL_Surface * pImage, std::vector<Uint32> & scratch, GLsizei & pitch);
+	void ExpandAlpha (Uint32 * pDest, Uint8 const * pSrc, int count);
+	void HalveRGBA (Uint32 * pDest, Uint8 const * pSrc, GLsizei w, GLsizei h, GLsizei pitch);
+	void MergeCoverage (Uint8 * pDest, Uint8 const * pSrc, int count);
+	bool WritePNG (std::string const & name, Uint8 const * pPixels, int w, int h, int pitch);
+	bool MakeCacheDir (std::string const & dir);
+	std::string CanonicalPath (std::string const & name);
+
 	/// @brief 26.6 fixed-point grid-fitting routines
 	#define Round(x)((x) & -64)
 	#define Floor(x) Round(x + 32)
 	#define Ceiling(x) Round(x + 63)
 
-	/// @brief Internal image representation
+	/// @brief Table of objects addressed through generation-checked handles
+	/// @note A handle packs a slot's index plus one into its low 16 bits and the slot's
+	/// generation into the rest. Freeing a slot bumps its generation, so handles to objects
+	/// since unloaded no longer match and are rejected.
+	template<typename T> struct SlotMap {
+		/// @brief Entry in the table
+		struct Slot {
+			T * mObject;///< Object held in slot, or 0 if free
+			Uint16 mGeneration;	///< Count of times the slot has been freed
+		};
+	// Members
+		std::vector<Slot> mSlots;	///< Slots, in use or free
+		std::vector<Uint16> mFree;	///< Indices of free slots
+	// Methods
+		/// @brief Adds an object to the table
+		/// @param object Object to add
+		/// @return Handle to object, or 0 if the table is full
+		void * Add (T * object)
+		{
+			Uint32 index;
+
+			if (!mFree.empty())
+			{
+				index = mFree.back();
+
+				mFree.pop_back();
+			}
+
+			else
+			{
+				if (mSlots.size() == 0xFFFF) return 0;
+
+				Slot slot = { 0, 0 };
+
+				index = Uint32(mSlots.size());
+
+				mSlots.push_back(slot);
+			}
+
+			mSlots[index].mObject = object;
+
+			return reinterpret_cast<void *>((size_t(mSlots[index].mGeneration) << 16) | (index + 1));
+		}
+
+		/// @brief Looks up an object
+		/// @param handle Handle to object
+		/// @return Object, or 0 if the handle is invalid or stale
+		T * Get (void const * handle) const
+		{
+			size_t id = reinterpret_cast<size_t>(handle);
+			size_t index = (id & 0xFFFF) - 1;
+
+			if (index >= mSlots.size() || mSlots[index].mGeneration != id >> 16) return 0;
+
+			return mSlots[index].mObject;
+		}
+
+		/// @brief Removes an object from the table
+		/// @param handle Handle to object
+		/// @return Object, or 0 if the handle is invalid or stale
+		T * Remove (void const * handle)
+		{
+			T * object = Get(handle);
+
+			if (object != 0) Free((reinterpret_cast<size_t>(handle) & 0xFFFF) - 1);
+
+			return object;
+		}
+
+		/// @brief Deletes every object in the table, invalidating all handles
+		void DeleteAll (void)
+		{
+			for (size_t index = 0; index < mSlots.size(); ++index)
+			{
+				if (0 == mSlots[index].mObject) continue;
+
+				delete mSlots[index].mObject;
+
+				Free(index);
+			}
+		}
+
+		/// @brief Frees a slot
+		/// @param index Index of slot
+		void Free (size_t index)
+		{
+			mSlots[index].mObject = 0;
+
+			++mSlots[index].mGeneration;
+
+			mFree.push_back(Uint16(index));
+		}
+	};
+
+	/// @brief Ways in which primitives are blended into the render target
+	enum Shade {
+		eBlend,	///< Colors are blended by their alpha
+		eField,	///< The texture holds distance fields, drawn solid inside their edges
+		ePremultiplied	///< Colors are already scaled by their alpha, as in layers
+	};
+
+	/// @brief Vertex used to batch primitives
+	struct Vertex {
+		GLfloat mX, mY;	///< Screen position
+		GLfloat mS, mT;	///< Texture coordinates
+		GLubyte mColor[4];	///< Vertex color
+	};
+
+	/// @brief Device that carries out rendering
+	/// @note The public methods keep statistics and filter out redundant texture binds,
+	/// handing the remaining work to the device-specific Do* methods
+	struct Backend {
+	// Members
+		RenderStats mStats;	///< Statistics for the frame in progress
+		RenderStats mLastStats;	///< Statistics for the last completed frame
+		std::string mCapture;	///< File to which the next presented frame is written, if any
+		std::map<GLuint, GLenum> mFormats;	///< Texel format of each texture, GL_RGBA or GL_ALPHA
+		GLuint mBound;	///< Texture bound for drawing, or c_Unbound if unknown
+		GLuint mTarget;	///< Texture rendered into, or 0 for the screen
+		GLint mOrigin[2];	///< Screen position, in pixels, of the render target's bottom-left corner
+		bool mNPOT;	///< If true, textures may have sizes other than powers of 2
+		bool mRetained;	///< If true, the screen keeps its pixels from one frame to the next
+		bool mTargets;	///< If true, textures may be rendered into
+	// Methods
+		Backend (void);
+		virtual ~Backend (void);
+
+		void Clear (void);
+		void Draw (GLenum mode, GLuint texture, Vertex const * pVerts, GLsizei count, Shade shade = eBlend);
+		void Present (void);
+		void Scissor (GLint x, GLint y, GLsizei w, GLsizei h);
+		void SetTarget (GLuint texture, GLint x, GLint y, GLsizei w, GLsizei h);
+		GLsizei FitTexture (GLsizei size);
+		GLuint CreateTexture (GLsizei w, GLsizei h, GLenum format = GL_RGBA);
+		void UpdateTexture (GLuint texture, GLint x, GLint y, GLsizei w, GLsizei h, GLsizei pitch, void const * pPixels);
+		void DeleteTexture (GLuint texture);
+
+		virtual bool Attach (void);
+		virtual bool Capture (std::string const & name);
+		virtual bool Detach (void);
+		virtual bool Dump (std::ostream & stream);
+		virtual bool Open (int width, int height, int bpp, bool bFullscreen) = 0;
+
+		static Backend * Make (std::string const & name);
+		static GLsizei TexelSize (GLenum format);
+	protected:
+		virtual void DoBind (GLuint texture) = 0;
+		virtual void DoClear (void) = 0;
+		virtual void DoDraw (GLenum mode, Vertex const * pVerts, GLsizei count, Shade shade) = 0;
+		virtual void DoPresent (void) = 0;
+		virtual void DoScissor (GLint x, GLint y, GLsizei w, GLsizei h) = 0;
+		virtual void DoSetTarget (GLuint texture, GLint x, GLint y, GLsizei w, GLsizei h) = 0;
+		virtual GLuint DoCreateTexture (GLsizei w, GLsizei h, GLenum format) = 0;
+		virtual void DoUpdateTexture (GLuint texture, GLenum format, GLint x, GLint y, GLsizei w, GLsizei h, GLsizei pitch, void const * pPixels) = 0;
+		virtual void DoDeleteTexture (GLuint texture) = 0;
+	};
+
+	/// @brief Backend that renders through OpenGL
+	/// @note OpenGL state is set through a shadow copy, so that redundant changes are never
+	/// sent to the driver and the state never has to be queried back
+	struct GLBackend : Backend {
+		/// @brief Shadow of the OpenGL state set by the backend
+		struct State {
+			GLuint mTexture;///< Texture bound to GL_TEXTURE_2D
+			GLint mScissor[4];	///< Scissor rectangle: x, y, width, and height
+			GLint mRowLength;	///< Value of GL_UNPACK_ROW_LENGTH
+			GLenum mBlendFunc[4];	///< Source and destination blend factors, for color and then for alpha
+			int mTexturing;	///< GL_TEXTURE_2D enable: 0 if disabled, 1 if enabled, -1 if unknown
+			int mBlending;	///< GL_BLEND enable: 0 if disabled, 1 if enabled, -1 if unknown
+			int mAlphaTest;	///< GL_ALPHA_TEST enable: 0 if disabled, 1 if enabled, -1 if unknown
+			int mThreshold;	///< Texture alpha thresholded to opaque: 0 if not, 1 if so, -1 if unknown
+		};
+	// Members
+		std::map<GLuint, GLuint> mFramebuffers;	///< Framebuffer object rendering into each texture rendered into so far
+		State mState;	///< State of the current context
+		PFNGLBINDFRAMEBUFFEREXTPROC mBindFramebuffer;	///< glBindFramebufferEXT, if supported
+		PFNGLCHECKFRAMEBUFFERSTATUSEXTPROC mCheckFramebufferStatus;	///< glCheckFramebufferStatusEXT, if supported
+		PFNGLDELETEFRAMEBUFFERSEXTPROC mDeleteFramebuffers;	///< glDeleteFramebuffersEXT, if supported
+		PFNGLFRAMEBUFFERTEXTURE2DEXTPROC mFramebufferTexture2D;	///< glFramebufferTexture2DEXT, if supported
+		PFNGLGENFRAMEBUFFERSEXTPROC mGenFramebuffers;	///< glGenFramebuffersEXT, if supported
+		PFNGLBLENDFUNCSEPARATEEXTPROC mBlendFuncSeparate;	///< glBlendFuncSeparateEXT, if supported
+		void * mDC;	///< Device context of the window, kept while detached, on Windows
+		void * mContext;///< OpenGL context, kept while detached, on Windows
+	// Methods
+		GLBackend (void);
+
+		bool Attach (void);
+		bool Capture (std::string const & name);
+		bool Detach (void);
+		bool Open (int width, int height, int bpp, bool bFullscreen);
+	protected:
+		bool Change (bool bChanged);
+		void Invalidate (void);
+		void SetAlphaTest (bool bEnabled);
+		void SetBlending (bool bEnabled, GLenum src, GLenum dst, GLenum srcAlpha, GLenum dstAlpha);
+		void SetRowLength (GLint length);
+		void SetTexture (GLuint texture);
+		void SetTexturing (bool bEnabled);
+		void SetThreshold (bool bEnabled);
+
+		void DoBind (GLuint texture);
+		void DoClear (void);
+		void DoDraw (GLenum mode, Vertex const * pVerts, GLsizei count, Shade shade);
+		void DoPresent (void);
+		void DoScissor (GLint x, GLint y, GLsizei w, GLsizei h);
+		void DoSetTarget (GLuint texture, GLint x, GLint y, GLsizei w, GLsizei h);
+		GLuint DoCreateTexture (GLsizei w, GLsizei h, GLenum format);
+		void DoUpdateTexture (GLuint texture, GLenum format, GLint x, GLint y, GLsizei w, GLsizei h, GLsizei pitch, void const * pPixels);
+		void DoDeleteTexture (GLuint texture);
+	};
+
+	/// @brief Backend that rasterizes into an RGBA framebuffer in memory
+	struct SoftwareBackend : Backend {
+		/// @brief Texture kept in memory
+		struct Texture {
+			std::vector<Uint32> mTexels;///< RGBA texels, top row first; alpha textures are expanded to white
+			GLsizei mW;	///< Texture width
+			GLsizei mH;	///< Texture height
+		};
+	// Members
+		std::map<GLuint, Texture> mTextures;///< Textures, by name
+		std::vector<Uint32> mPixels;///< RGBA framebuffer, top row first
+		std::vector<Uint32> mSpan;	///< Scratch row of source pixels
+		Texture * mTexture;	///< Texture bound for drawing, or 0 if untextured
+		Texture * mLayer;	///< Texture rendered into, bottom row first, or 0 for the framebuffer
+		SDL_Surface * mScreen;	///< Screen surface to which frames are shown, if any
+		GLint mScissor[4];	///< Scissor rectangle: left, bottom, right, and top edges
+		GLint mRect[4];	///< Screen rectangle covered by the render target: left, bottom, right, and top edges
+		GLsizei mW;	///< Framebuffer width
+		GLsizei mH;	///< Framebuffer height
+		GLuint mNextTexture;///< Name given to the next texture created
+	// Methods
+		SoftwareBackend (void);
+
+		bool Capture (std::string const & name);
+		bool Detach (void);
+		bool Open (int width, int height, int bpp, bool bFullscreen);
+	protected:
+		void DoBind (GLuint texture);
+		void DoClear (void);
+		void DoDraw (GLenum mode, Vertex const * pVerts, GLsizei count, Shade shade);
+		void DoPresent (void);
+		void DoScissor (GLint x, GLint y, GLsizei w, GLsizei h);
+		void DoSetTarget (GLuint texture, GLint x, GLint y, GLsizei w, GLsizei h);
+		GLuint DoCreateTexture (GLsizei w, GLsizei h, GLenum format);
+		void DoUpdateTexture (GLuint texture, GLenum format, GLint x, GLint y, GLsizei w, GLsizei h, GLsizei pitch, void const * pPixels);
+		void DoDeleteTexture (GLuint texture);
+
+		void DrawLine (Vertex const & start, Vertex const & end);
+		void DrawQuad (Vertex const * pCorners, Shade shade);
+		Uint32 GetFloor (Shade shade) const;
+		Uint32 * Pixel (GLint x, GLint y);
+	};
+
+	/// @brief Command captured by the recording backend
+	struct Command {
+		/// @brief Kinds of command
+		enum Type {
+			eBind, eClear, eDraw, ePresent, eScissor, eTarget,
+			eCreateTexture, eUpdateTexture, eDeleteTexture,
+			eTypeCount
+		};
+	// Members
+		Type mType;	///< Kind of command
+		GLuint mTexture;///< Texture operated on, if any
+		GLint mArgs[4];	///< Scissor, target, or texture rectangle; texture size and format; primitive mode, first vertex, vertex count, and shading
+	};
+
+	/// @brief Backend that records commands in memory instead of rendering them
+	struct RecordBackend : Backend {
+	// Members
+		std::vector<Command> mCommands;	///< Commands recorded in the frame in progress
+		std::vector<Command> mFrame;///< Commands recorded in the last completed frame
+		std::vector<Vertex> mVertices;	///< Vertices drawn in the frame in progress
+		std::vector<Vertex> mFrameVertices;	///< Vertices drawn in the last completed frame
+		Uint32 mTotals[Command::eTypeCount];///< Commands recorded since the backend was made, by kind
+		Uint32 mFrames;	///< Count of completed frames
+		GLuint mNextTexture;///< Name given to the next texture created
+	// Methods
+		RecordBackend (void);
+
+		bool Dump (std::ostream & stream);
+		bool Open (int width, int height, int bpp, bool bFullscreen);
+	protected:
+		void DoBind (GLuint texture);
+		void DoClear (void);
+		void DoDraw (GLenum mode, Vertex const * pVerts, GLsizei count, Shade shade);
+		void DoPresent (void);
+		void DoScissor (GLint x, GLint y, GLsizei w, GLsizei h);
+		void DoSetTarget (GLuint texture, GLint x, GLint y, GLsizei w, GLsizei h);
+		GLuint DoCreateTexture (GLsizei w, GLsizei h, GLenum format);
+		void DoUpdateTexture (GLuint texture, GLenum format, GLint x, GLint y, GLsizei w, GLsizei h, GLsizei pitch, void const * pPixels);
+		void DoDeleteTexture (GLuint texture);
+
+		void Add (Command::Type type, GLuint texture, GLint a0 = 0, GLint a1 = 0, GLint a2 = 0, GLint a3 = 0);
+	};
+
+	/// @brief Backend that queues device commands for a render thread, which carries them out
+	/// through another backend while the next frame is built
+	/// @note Each frame's commands fill one of two frames; Present waits for the render thread
+	/// to finish the other, then hands it the one just filled. Texture names are handed out at
+	/// once and mapped to the device's own names on the render thread. If the device cannot
+	/// be driven from another thread, each frame is carried out when presented
+	struct ThreadedBackend : Backend {
+		/// @brief Commands of one frame
+		struct Frame {
+			std::vector<Command> mCommands;	///< Commands, in the order issued
+			std::vector<Vertex> mVertices;	///< Vertices drawn, in order
+			std::vector<Uint8> mPixels;	///< Pixels uploaded, in order, with rows packed
+			std::string mCapture;	///< File to which the frame is written, if any
+		};
+	// Members
+		Frame mFrames[2];	///< Frame being filled, and frame being carried out
+		std::map<GLuint, GLuint> mNames;///< Device texture for each texture handed out; used by the render thread
+		Backend * mDevice;	///< Backend carrying out the commands
+		SDL_Thread * mThread;	///< Render thread, or 0 if frames are carried out when presented
+		SDL_sem * mReady;	///< Posted when a frame is handed to the render thread
+		SDL_sem * mDone;	///< Posted when the render thread is idle
+		GLuint mNextTexture;///< Name given to the next texture created
+		int mFilling;	///< Index of the frame being filled
+		bool mRunning;	///< If true, the render thread drives the device; if false, it exits
+	// Methods
+		ThreadedBackend (Backend * device);
+		~ThreadedBackend (void);
+
+		bool Capture (std::string const & name);
+		bool Dump (std::ostream & stream);
+		bool Open (int width, int height, int bpp, bool bFullscreen);
+
+		Backend * Release (void);
+	protected:
+		void DoBind (GLuint texture);
+		void DoClear (void);
+		void DoDraw (GLenum mode, Vertex const * pVerts, GLsizei count, Shade shade);
+		void DoPresent (void);
+		void DoScissor (GLint x, GLint y, GLsizei w, GLsizei h);
+		void DoSetTarget (GLuint texture, GLint x, GLint y, GLsizei w, GLsizei h);
+		GLuint DoCreateTexture (GLsizei w, GLsizei h, GLenum format);
+		void DoUpdateTexture (GLuint texture, GLenum format, GLint x, GLint y, GLsizei w, GLsizei h, GLsizei pitch, void const * pPixels);
+		void DoDeleteTexture (GLuint texture);
+
+		void Add (Command::Type type, GLuint texture, GLint a0 = 0, GLint a1 = 0, GLint a2 = 0, GLint a3 = 0);
+		void Finish (void);
+		void Play (Frame & frame);
+		void Stop (void);
+
+		static int Render (void * pData);
+	};
+
+	/// @brief Run of primitives that share a texture and primitive type
+	struct Batch {
+	// Members
+		std::vector<Vertex> mVertices;	///< Vertices awaiting submission
+		GLuint mTexture;///< Texture used by batch, or 0 if untextured
+		GLenum mMode;	///< Primitive type of batch
+		GLfloat mClip[4];	///< Scissor rectangle, in pixels: left, bottom, right, and top edges
+		Shade mShade;	///< Blending of the primitives
+	// Methods
+		Batch (void);
+
+		void AddLine (GLfloat fSX, GLfloat fSY, GLfloat fEX, GLfloat fEY, GLubyte const * color);
+		void AddQuad (GLfloat fSX, GLfloat fSY, GLfloat fEX, GLfloat fEY, GLfloat fS0, GLfloat fT0, GLfloat fS1, GLfloat fT1, GLubyte const * color);
+		bool CullLines (GLfloat fSX, GLfloat fSY, GLfloat fEX, GLfloat fEY, Uint32 count);
+		bool CullQuads (GLfloat fSX, GLfloat fSY, GLfloat fEX, GLfloat fEY, Uint32 count);
+		void Flush (void);
+		bool InClip (GLfloat fSX, GLfloat fSY, GLfloat fEX, GLfloat fEY) const;
+		void Prepare (GLuint texture, GLenum mode, Shade shade = eBlend);
+	};
+
+	/// @brief Page of a texture atlas, packed with a skyline
+	struct AtlasPage {
+		/// @brief Horizontal segment of the skyline
+		struct Span {
+			GLint mX;	///< Left edge of span
+			GLint mY;	///< Height of skyline along span
+			GLint mW;	///< Width of span
+		};
+	// Members
+		std::vector<Span> mSkyline;	///< Skyline, ordered left to right
+		GLuint mTexture;///< Texture holding the page, or 0 if evicted
+		GLsizei mW;	///< Page width
+		GLsizei mH;	///< Page height
+		GLenum mFormat;	///< Texel format of page
+		Uint32 mCount;	///< Count of images packed into page
+		Uint32 mUsed;	///< Frame in which page was last drawn
+	// Methods
+		AtlasPage (GLsizei w, GLsizei h, GLenum format);
+		~AtlasPage (void);
+
+		bool Allocate (GLsizei w, GLsizei h, GLint & x, GLint & y);
+		GLint Fit (Uint32 index, GLsizei w, GLsizei h);
+		void UploadExtruded (Uint8 const * pPixels, GLsizei w, GLsizei h, GLsizei pitch, GLint x, GLint y);
+	};
+
+	/// @brief Texture atlas used to pack images into a few large textures
+	struct Atlas {
+	// Members
+		std::list<AtlasPage*> mPages;	///< Pages in use
+		GLsizei mPageSize;	///< Width and height of an ordinary page
+		GLenum mFormat;	///< Texel format of pages
+	// Methods
+		Atlas (GLsizei pageSize, GLenum format = GL_RGBA);
+		~Atlas (void);
+
+		AtlasPage * Insert (void const * pPixels, GLsizei w, GLsizei h, GLsizei pitch, GLint & x, GLint & y);
+		AtlasPage * InsertExtruded (Uint8 const * pPixels, GLsizei w, GLsizei h, GLsizei pitch, GLint & x, GLint & y);
+		AtlasPage * Reserve (GLsizei w, GLsizei h, GLint & x, GLint & y);
+		void Release (AtlasPage * page);
+	};
+
+	struct DecodeJob;
+	struct ImageData;
+
+	/// @brief Internal image representation; images too large for the atlas are split into
+	/// tiles, each uploaded when first drawn
 	struct Image {
+		/// @brief Piece of a tiled image, held in a texture of its own with a border of the
+		/// neighboring pixels
+		struct Tile {
+			GLuint mTexture;///< Texture holding the tile, or 0 if not resident
+			Uint32 mUsed;	///< Frame in which tile was last drawn
+		};
 	// Members
-		GLuint mTexture;///< Texture used by image
+		std::vector<Tile> mTiles;	///< Tiles, left to right and top to bottom, if the image is tiled
+		AtlasPage * mPage;	///< Atlas page holding image, or 0 if it is tiled, loading, or failed to load
+		DecodeJob * mJob;	///< Decode under way on a worker thread, if any
+		ImageData * mSource;///< Pixels from which tiles are uploaded, if the image is tiled
+		GLfloat mS0;///< Initial s-coordinate of image within page
+		GLfloat mS1;///< Terminal s-coordinate of image within page
+		GLfloat mT0;///< Initial t-coordinate of image within page
+		GLfloat mT1;///< Terminal t-coordinate of image within page
+		GLint mX;	///< Left edge of image within page
+		GLint mY;	///< Top edge of image within page
+		GLsizei mW;	///< Image width
+		GLsizei mH;	///< Image height
+		GLsizei mThumbnail;	///< Size toward which a thumbnail's pixels are halved, or 0 if the image is full size
+		std::string mName;	///< Name of file from which image was loaded
 		Uint32 mCount;	///< Reference count for image sprites
 	// Methods
-		Image (std::string const & name);
+		Image (std::string const & name, bool bAsync = false, GLsizei thumbnail = 0);
 		~Image (void);
+
+		bool Finish (void);
+		bool IsPlaced (void) const;
+		void Place (ImageData * data);
+		void Reload (void);
+		void UploadTile (Uint32 index);
+	};
+
+	/// @brief Read-only view of a whole file, mapped into memory
+	struct MappedFile {
+	// Members
+		Uint8 const * mData;///< File contents, or 0 if not mapped
+		size_t mSize;	///< Size of file, in bytes
+		void * mHandle;	///< Platform handle keeping the mapping alive, if any
+	// Methods
+		MappedFile (void);
+		~MappedFile (void);
+
+		bool Open (std::string const & name);
+		void Close (void);
+	private:
+		MappedFile (MappedFile const &);
+		MappedFile & operator = (MappedFile const &);
+	};
+
+	/// @brief Asset pack, mapped into memory and searched for files before they are read
+	/// from disk
+	struct Pack {
+	// Members
+		MappedFile mFile;	///< Pack contents
+		PackEntry const * mEntries;	///< Index of files, sorted by name
+		Uint32 mCount;	///< Count of files
+		Uint32 mTime;	///< Modification time of pack, standing in for those of its files
+	// Methods
+		Pack (void);
+
+		bool Open (std::string const & name);
+		void Close (void);
+		PackEntry const * Find (std::string const & name) const;
+		Uint8 const * GetData (PackEntry const * entry) const;
+		std::string GetName (PackEntry const * entry) const;
+	};
+
+	/// @brief RGBA pixels of an image file, mapped from the decoded-image cache or decoded
+	struct ImageData {
+	// Members
+		MappedFile mFile;	///< Pixels found in the cache
+		std::vector<Uint32> mScratch;	///< Decoded pixels, if they needed converting to RGBA
+		SDL_Surface * mSurface;	///< Decoded image, if not found in the cache
+		Uint8 const * mPixels;	///< RGBA pixels, or 0 if not loaded
+		GLsizei mW;	///< Image width
+		GLsizei mH;	///< Image height
+		GLsizei mPitch;	///< Bytes per row of pixels
+	// Methods
+		ImageData (void);
+		~ImageData (void);
+
+		bool Load (std::string const & name);
+		void Reduce (GLsizei size);
+	private:
+		ImageData (ImageData const &);
+		ImageData & operator = (ImageData const &);
+	};
+
+	/// @brief Image file decoded on a worker thread
+	struct DecodeJob {
+	// Members
+		ImageData * mData;	///< Pixels, once decoded
+		std::string mName;	///< Name of image file
+		Image * mImage;	///< Image awaiting the pixels, or 0 if it was unloaded
+		GLsizei mThumbnail;	///< Size toward which the pixels are halved, or 0 to keep them full size
+		bool mLoaded;	///< If true, the pixels were decoded
+	// Methods
+		DecodeJob (Image * image);
+		~DecodeJob (void);
+
+		void Run (void);
+	};
+
+	/// @brief Pool of threads decoding images loaded asynchronously, whose pixels are placed
+	/// in the atlas by the thread that owns the renderer
+	struct Decoder {
+	// Members
+		std::list<DecodeJob*> mQueue;	///< Jobs awaiting a thread
+		std::list<DecodeJob*> mDone;///< Jobs decoded, awaiting placement
+		std::vector<SDL_Thread*> mThreads;	///< Worker threads
+		SDL_mutex * mLock;	///< Lock guarding the job lists
+		SDL_sem * mWork;///< Posted once per job queued, and once per thread when stopping
+		void (*mNotify)(void);	///< Called on a worker thread as each job is decoded, if set
+		Uint32 mBusy;	///< Count of jobs being decoded
+		bool mRunning;	///< If true, the workers keep taking jobs
+	// Methods
+		Decoder (void);
+		~Decoder (void);
+
+		bool Add (DecodeJob * job);
+		void Cancel (DecodeJob * job);
+		void Count (Uint32 & decoding, Uint32 & ready);
+		DecodeJob * Next (void);
+		void Stop (void);
+		void Wait (DecodeJob * job);
+
+		static int Worker (void * pData);
 	};
 
 	/// @brief Internal picture representation
@@ -42,47 +621,243 @@ namespace Graphics
 	// Methods
 		Picture (Image * image);
 		~Picture (void);
+
+		void GetAtlasTexels (GLfloat & fS0, GLfloat & fT0, GLfloat & fS1, GLfloat & fT1) const;
+	};
+
+	/// @brief Internal nine-slice representation: a frame of pictures whose corners keep
+	/// their size while its sides and middle stretch
+	struct NineSlice {
+		/// @brief Picture drawn in one cell of the frame
+		struct Cell {
+			void * mPicture;///< Handle to picture, or 0 if the cell is empty
+			bool mFlipH;///< If true, the picture is flipped horizontally
+			bool mFlipV;///< If true, the picture is flipped vertically
+		};
+	// Members
+		Cell mCells[9];	///< Cells, left to right and top to bottom
+		GLfloat mStretchW;	///< Width above which the middle column stretches
+		GLfloat mStretchH;	///< Height above which the middle row stretches
+	// Methods
+		NineSlice (void);
+	};
+
+	/// @brief Draw call recorded into a block
+	struct BlockCommand {
+		/// @brief Renderer call recorded
+		enum Type {
+			eBox,	///< DrawBox
+			eGrid,	///< DrawGrid
+			eLayer,	///< DrawLayer
+			eLine,	///< DrawLine
+			eNineSlice,	///< DrawNineSlice
+			ePicture,	///< DrawPictureEx
+			ePopBounds,	///< PopBounds
+			ePushBounds,///< PushBounds
+			eSetBounds,	///< SetBounds
+			eText,	///< DrawText
+			eTextImage	///< DrawTextImage
+		};
+	// Members
+		Type mType;	///< Call recorded
+		void * mHandle;	///< Handle to the picture, text image, font, nine-slice, or layer drawn
+		GLfloat mArgs[7];	///< Coordinates and dimensions, followed by any color
+		Uint32 mFlags[2];	///< Flips, grid cuts, or skipping of empty cells
+		std::string mText;	///< Text drawn
+	};
+
+	/// @brief Internal block representation: draw calls recorded once, to be replayed
+	/// each frame, at an offset if need be
+	struct Block {
+	// Members
+		std::vector<BlockCommand> mCommands;///< Calls, in the order made
+	};
+
+	/// @brief Internal layer representation: a texture holding a screen rectangle, rendered
+	/// once and then drawn as one quad
+	/// @note Colors are stored premultiplied by alpha, bottom row first
+	struct Layer {
+	// Members
+		GLuint mTexture;///< Texture holding the layer, or 0 if not yet rendered
+		GLint mX;	///< Left edge of rectangle, in pixels
+		GLint mY;	///< Bottom edge of rectangle, in pixels
+		GLsizei mW;	///< Rectangle width, in pixels
+		GLsizei mH;	///< Rectangle height, in pixels
+		GLsizei mTexW;	///< Texture width
+		GLsizei mTexH;	///< Texture height
+		Uint32 mRendered;	///< Frame in which layer was last rendered
+		Uint32 mPlaced;	///< Count of images placed by the core when layer was last rendered
+		bool mMissing;	///< If true, pictures still loading were left out when layer was last rendered
+	// Methods
+		Layer (void);
+		~Layer (void);
+	};
+
+	/// @brief Screen rectangle, in pixels
+	struct Rect {
+		GLint mX0;	///< Left edge
+		GLint mY0;	///< Bottom edge
+		GLint mX1;	///< Right edge
+		GLint mY1;	///< Top edge
+	};
+
+	/// @brief Call made to the screen, as matched against those of another frame to find
+	/// what changed between them
+	struct FrameCall {
+	// Members
+		Uint32 mHash;	///< Hash of the call
+		Uint32 mKey;///< Hash of the call and of the draw call made before it
+		Rect mRect;	///< Screen pixels the call may touch
+	// Methods
+		bool operator < (FrameCall const & other) const
+		{
+			return mKey < other.mKey;
+		}
 	};
 
-	// @brief Internal face representation
+	struct Font;
+
+	// @brief Internal face representation, shared by every name for its file
 	struct Face {
 	// Members
-		std::map<int, FT_Size> mSizes;	///< Sizes bound to face
+		std::map<int, Font*> mSizes;///< Sizes bound to face
+		std::string mName;	///< Name of face within the core: its name in the asset pack, or else the canonical path of its file
+		MappedFile mFile;	///< Face file, unless read from the asset pack
 		FT_Face mFace;	///< Face data used by FreeType
+		Font * mField;	///< Font holding the distance-field glyphs drawn for every size, if made
 	// Methods
 		Face (std::string const & name);
 		~Face (void);
 
-		FT_Size GetSize (std::string const & name, int size);
+		Font * GetField (void);
+		Font * GetSize (int size);
+	};
+
+	/// @brief Glyph rasterized into a font's atlas
+	struct Glyph {
+	// Members
+		AtlasPage * mPage;	///< Page holding glyph bitmap, or 0 if glyph is blank
+		GLfloat mS0;///< Initial s-coordinate of bitmap within page
+		GLfloat mS1;///< Terminal s-coordinate of bitmap within page
+		GLfloat mT0;///< Initial t-coordinate of bitmap within page
+		GLfloat mT1;///< Terminal t-coordinate of bitmap within page
+		GLint mLeft;///< Offset from pen to left edge of bitmap
+		GLint mTop;	///< Offset from baseline up to top edge of bitmap
+		GLsizei mW;	///< Bitmap width
+		GLsizei mH;	///< Bitmap height
+	};
+
+	/// @brief Internal font representation, i.e. a face at a given size
+	struct Font {
+	// Members
+		std::map<FT_ULong, Glyph> mGlyphs;	///< Glyphs rasterized so far
+		FT_Pos mAdvances[256];	///< Advance of each character, in 26.6 fixed point, or -1 if not yet measured
+		Atlas mAtlas;	///< Atlas holding glyph bitmaps
+		Face * mFace;	///< Face from which font was built
+		Font * mField;	///< Font whose distance-field glyphs are drawn for this one, or 0 if it has its own
+		FT_Size mSize;	///< Size data used by FreeType
+		void * mHandle;	///< Handle shared by all loads of the font
+		Uint32 mCount;	///< Reference count for font handles
+		int mPixels;///< Pixel size of font
+		int mSpread;///< Reach of distance-field glyphs, in pixels, or 0 if glyphs hold coverage
+	// Methods
+		Font (Face * face, int size);
+		~Font (void);
+
+		void Bake (std::vector<FT_ULong> const & codes);
+		FT_Pos GetAdvance (Uint8 code);
+		Glyph const & GetGlyph (FT_ULong code);
 	};
 
 	/// @brief Internal text image representation
 	struct TextImage {
 	// Members
-		GLuint mTexture;///< Texture used by text image
+		std::vector<Uint8> mPixels;	///< Alpha pixels, kept to restore the texture after eviction
+		GLuint mTexture;///< Texture used by text image, or 0 if evicted
 		FT_Glyph mGlyph;///< Glyph information pertinent to character
 		GLfloat mS;	///< Texture s-extent
 		GLfloat mT;	///< Texture t-extent
+		GLsizei mW;	///< Image width
+		GLsizei mH;	///< Image height
+		GLubyte mColor[4];	///< Color in which text is drawn
+		Uint32 mBytes;	///< Size of texture, in bytes
+		Uint32 mUsed;	///< Frame in which text image was last drawn
 	// Methods
-		TextImage (FT_Size pSize, std::string const & text, SDL_Color color);
+		TextImage (Font * font, std::string const & text, SDL_Color color);
 		~TextImage (void);
+
+		void Upload (void);
+	};
+
+	/// @brief Render bounds, in normalized screen coordinates
+	struct Bounds {
+		float mX;	///< Left edge, in [0, 1]
+		float mY;	///< Top edge, in [0, 1], measured down
+		float mW;	///< Width, in [0, 1]
+		float mH;	///< Height, in [0, 1]
 	};
 
 	/// @brief Structure used to represent the graphics renderer
 	struct Main {
 	// Members
+		std::vector<Bounds> mBounds;///< Stack of render bounds, each within the last; the top is in force
 		std::map<std::string, Image*> mImages;	///< Images stored in the core
+		std::map<std::pair<std::string, GLsizei>, Image*> mThumbnails;	///< Thumbnails stored in the core, by file name and size
 		std::map<std::string, Face*> mFaces;///< Faces stored in the core
-		std::list<Picture*> mPictures;	///< Pictures stored in the core
-		std::list<TextImage*> mTextImages;	///< Text images stored in the core
+		SlotMap<Font> mFonts;	///< Font sizes handed out by the core
+		SlotMap<Picture> mPictures;	///< Pictures stored in the core
+		SlotMap<TextImage> mTextImages;	///< Text images stored in the core
+		SlotMap<NineSlice> mNineSlices;	///< Nine-slices stored in the core
+		SlotMap<Block> mBlocks;	///< Blocks stored in the core
+		SlotMap<Layer> mLayers;	///< Layers stored in the core
+		std::vector<Layer*> mTargets;	///< Stack of layers being rendered into; the top is in force
+		std::vector<BlockCommand> mCalls;	///< Calls made to the screen in the frame in progress, put off until the damage is known
+		std::vector<FrameCall> mFrameCalls;	///< Keys and extents of those calls that draw
+		std::vector<FrameCall> mLastCalls;	///< Keys and extents of the calls of the last frame, sorted by key
+		std::vector<Rect> mDamage;	///< Screen rectangles repainted in the frame in progress, none overlapping
+		std::vector<std::pair<int (*)(void *), void *> > mUnloads;	///< Unloads put off until the calls are carried out
+		Layer * mCanvas;	///< Layer holding the screen between frames, if the backend does not keep it
+		Rect mRepaint;	///< Screen rectangle being repainted, to which the bounds are confined
+		Atlas mAtlas;	///< Atlas into which images are packed
+		Batch mBatch;	///< Primitives awaiting submission
+		Decoder mDecoder;	///< Threads decoding images loaded asynchronously
+		Pack mPack;	///< Pack searched for image and font files, if open
+		Backend * mBackend;	///< Device that carries out rendering
+		Block * mRecording;	///< Block into which draw calls are being recorded, if any
+		std::string mRenderer;	///< Name of backend made on setup
+		std::string mImageCache;///< Directory of decoded images, or empty if images are always decoded
 		FT_Library mFreeType;	///< Library used to maintain text
 		GLsizei mResW;	///< Resolution width
 		GLsizei mResH;	///< Resolution height
+		Uint32 mFrame;	///< Count of frames drawn
+		Uint32 mPlaced;	///< Count of images loaded asynchronously and placed in the atlas
+		Uint32 mTextureBudget;	///< Bytes of image and text image textures to keep resident, or 0 for no limit
+		Uint32 mEvictAge;	///< Frames a texture must go undrawn before it may be evicted
+		int mFieldSize;	///< Size at which distance-field glyphs are baked, or 0 to rasterize every size
+		bool mDamageTracking;	///< If true, only the parts of the screen that changed are repainted
+		bool mRenderThread;	///< If true, the backend made on setup carries out device work on a render thread
+		bool mDeferring;///< If true, calls made to the screen are put off until the frame is drawn
+		bool mRepaintAll;	///< If true, the whole screen is repainted when the frame is drawn
 		bool mInit;	///< If true, the system is initialized
 	// Methods
 		Main (void);
 		~Main (void);
 
+		void AddDamage (Rect rect);
+		void ApplyBounds (void);
+		void ApplyTarget (void);
+		void Defer (BlockCommand const & command);
+		bool Deferring (void) const;
+		void Evict (void);
+		void FindDamage (void);
+		bool PopBounds (void);
+		void PushBounds (Bounds const & bounds);
+		void SetBounds (Bounds const & bounds);
+		void Stream (void);
+		void Use (AtlasPage * page);
+		void Use (Image * image, Uint32 index);
+		void Use (TextImage * textImage);
+
 		static Main & Get (void);
 	};
 };
@@ -0,0 +1,155 @@
+/// @file
+/// Minimal PNG writer used to save rendered frames
+
+#include "Graphics_Imp.h"
+#include <algorithm>
+#include <fstream>
+
+namespace Graphics
+{
+	/// @brief Computes a running CRC-32, as used by PNG chunks
+	/// @param crc CRC of preceding data
+	/// @param pData Data to add
+	/// @param size Size of data
+	/// @return Updated CRC
+	/// @note Tested
+	static Uint32 CRC (Uint32 crc, Uint8 const * pData, size_t size)
+	{
+		static Uint32 table[256];
+		static bool bInit = false;
+
+		if (!bInit)
+		{
+			for (Uint32 index = 0; index < 256; ++index)
+			{
+				Uint32 value = index;
+
+				for (int bit = 0; bit < 8; ++bit) value = value & 1 ? 0xEDB88320 ^ (value >> 1) : value >> 1;
+
+				table[index] = value;
+			}
+
+			bInit = true;
+		}
+
+		crc = ~crc;
+
+		while (size-- != 0) crc = table[(crc ^ *pData++) & 0xFF] ^ (crc >> 8);
+
+		return ~crc;
+	}
+
+	/// @brief Appends a big-endian 32-bit value to a buffer
+	/// @param buffer Buffer to grow
+	/// @param value Value to append
+	/// @note Tested
+	static void Put32 (std::vector<Uint8> & buffer, Uint32 value)
+	{
+		buffer.push_back(Uint8(value >> 24));
+		buffer.push_back(Uint8(value >> 16));
+		buffer.push_back(Uint8(value >> 8));
+		buffer.push_back(Uint8(value));
+	}
+
+	/// @brief Writes a PNG chunk
+	/// @param file File to write
+	/// @param type Four-character chunk type
+	/// @param data Chunk data
+	/// @note Tested
+	static void PutChunk (std::ofstream & file, char const * type, std::vector<Uint8> const & data)
+	{
+		std::vector<Uint8> chunk;
+
+		Put32(chunk, Uint32(data.size()));
+
+		chunk.insert(chunk.end(), type, type + 4);
+		chunk.insert(chunk.end(), data.begin(), data.end());
+
+		Put32(chunk, CRC(0, &chunk[4], chunk.size() - 4));
+
+		file.write(reinterpret_cast<char const *>(&chunk[0]), std::streamsize(chunk.size()));
+	}
+
+	/// @brief Writes RGBA pixels to a PNG file
+	/// @param name Name of file to write
+	/// @param pPixels First row of pixels
+	/// @param w Image width
+	/// @param h Image height
+	/// @param pitch Bytes from one row to the next; negative if rows run bottom-up in memory
+	/// @return If true, the file was written
+	/// @note Tested
+	/// @note The image data is stored without compression, which keeps the writer free of
+	/// dependencies; the files are meant for tests and diffs, not distribution
+	bool WritePNG (std::string const & name, Uint8 const * pPixels, int w, int h, int pitch)
+	{
+		std::ofstream file(name.c_str(), std::ios::binary);
+
+		if (!file) return false;
+
+		static Uint8 const c_Signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+		file.write(reinterpret_cast<char const *>(c_Signature), sizeof(c_Signature));
+
+		// Header: dimensions, 8 bits per channel, RGBA, default methods, no interlace.
+		std::vector<Uint8> header;
+
+		Put32(header, w);
+		Put32(header, h);
+
+		header.push_back(8);
+		header.push_back(6);
+		header.push_back(0);
+		header.push_back(0);
+		header.push_back(0);
+
+		PutChunk(file, "IHDR", header);
+
+		// Gather the rows, each led by a "no filter" byte.
+		std::vector<Uint8> raw;
+
+		raw.reserve((w * 4 + 1) * h);
+
+		for (int row = 0; row < h; ++row, pPixels += pitch)
+		{
+			raw.push_back(0);
+			raw.insert(raw.end(), pPixels, pPixels + w * 4);
+		}
+
+		// Wrap the rows in a zlib stream of stored deflate blocks.
+		std::vector<Uint8> data;
+
+		data.push_back(0x78);
+		data.push_back(0x01);
+
+		size_t offset = 0;
+
+		do {
+			size_t size = std::min(raw.size() - offset, size_t(0xFFFF));
+
+			data.push_back(offset + size == raw.size() ? 1 : 0);
+			data.push_back(Uint8(size));
+			data.push_back(Uint8(size >> 8));
+			data.push_back(Uint8(~size));
+			data.push_back(Uint8(~size >> 8));
+
+			data.insert(data.end(), raw.begin() + offset, raw.begin() + offset + size);
+
+			offset += size;
+		} while (offset < raw.size());
+
+		Uint32 a = 1, b = 0;
+
+		for (size_t index = 0; index < raw.size(); ++index)
+		{
+			a = (a + raw[index]) % 65521;
+			b = (b + a) % 65521;
+		}
+
+		Put32(data, (b << 16) | a);
+
+		PutChunk(file, "IDAT", data);
+		PutChunk(file, "IEND", std::vector<Uint8>());
+
+		return file.good();
+	}
+}
@@ -0,0 +1,155 @@
+/// @file
+/// Asset packs, mapped whole and searched for image and font files by name
+
+#include "Graphics_Imp.h"
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <algorithm>
+#include <iostream>
+
+namespace Graphics
+{
+	/// @brief Gets the name under which a file is indexed in a pack
+	/// @param name Name of file
+	/// @return Name with every separator a forward slash, and with "." and ".." steps
+	/// taken out, e.g. "./Assets/Fonts/../Fonts/Vera.ttf" becomes "Assets/Fonts/Vera.ttf"
+	/// @note Tested
+	static std::string IndexName (std::string const & name)
+	{
+		std::vector<std::string> steps;
+
+		for (std::string::size_type start = 0, end; start <= name.size(); start = end + 1)
+		{
+			end = std::min(name.find_first_of("/\\", start), name.size());
+
+			std::string step = name.substr(start, end - start);
+
+			if ("." == step || (step.empty() && start > 0)) continue;
+
+			if (".." == step && !steps.empty() && steps.back() != ".." && !steps.back().empty()) steps.pop_back();
+
+			else steps.push_back(step);
+		}
+
+		std::string index;
+
+		for (std::vector<std::string>::size_type step = 0; step < steps.size(); ++step) index += (step > 0 ? "/" : "") + steps[step];
+
+		return index;
+	}
+
+	/// @brief Constructs a Pack object
+	/// @note Tested
+	Pack::Pack (void) : mEntries(0), mCount(0), mTime(0)
+	{
+	}
+
+	/// @brief Maps a pack and checks its index, replacing any pack already open
+	/// @param name Name of pack file
+	/// @return If true, the pack was opened
+	/// @note Tested
+	bool Pack::Open (std::string const & name)
+	{
+		Close();
+
+		struct stat info;
+
+		if (stat(name.c_str(), &info) != 0 || !mFile.Open(name)) return false;
+
+		// Check that the header, index, names, and contents all lie within the file, and
+		// that the names are in order, so that lookups need no further checks.
+		PackHeader const * pHeader = reinterpret_cast<PackHeader const *>(mFile.mData);
+
+		bool bValid = mFile.mSize >= sizeof(PackHeader) && c_PackMagic == pHeader->mMagic && c_PackVersion == pHeader->mVersion && pHeader->mCount <= (mFile.mSize - sizeof(PackHeader)) / sizeof(PackEntry);
+
+		PackEntry const * pEntries = reinterpret_cast<PackEntry const *>(pHeader + 1);
+
+		for (Uint32 index = 0; bValid && index < pHeader->mCount; ++index)
+		{
+			PackEntry const & entry = pEntries[index];
+
+			bValid = entry.mNameOffset <= mFile.mSize && entry.mNameLength <= mFile.mSize - entry.mNameOffset && entry.mOffset <= mFile.mSize && entry.mSize <= mFile.mSize - entry.mOffset;
+
+			if (bValid && index > 0)
+			{
+				std::string prev(reinterpret_cast<char const *>(mFile.mData + pEntries[index - 1].mNameOffset), pEntries[index - 1].mNameLength);
+
+				bValid = prev.compare(0, prev.size(), reinterpret_cast<char const *>(mFile.mData + entry.mNameOffset), entry.mNameLength) < 0;
+			}
+		}
+
+		if (!bValid)
+		{
+			std::cerr << "Invalid asset pack: " << name << std::endl;
+
+			mFile.Close();
+
+			return false;
+		}
+
+		mEntries = pEntries;
+		mCount = pHeader->mCount;
+		mTime = Uint32(info.st_mtime);
+
+		return true;
+	}
+
+	/// @brief Unmaps the pack, if one is open
+	/// @note Tested
+	void Pack::Close (void)
+	{
+		mFile.Close();
+
+		mEntries = 0;
+		mCount = 0;
+		mTime = 0;
+	}
+
+	/// @brief Looks a file up in the pack
+	/// @param name Name of file, as it would be opened from disk
+	/// @return Entry describing the file, or 0 if the pack does not hold it
+	/// @note Tested
+	/// @note The pack is only read, so files may be looked up from any thread
+	PackEntry const * Pack::Find (std::string const & name) const
+	{
+		std::string index = IndexName(name);
+
+		// Search the sorted index for the name.
+		Uint32 lower = 0, upper = mCount;
+
+		while (lower < upper)
+		{
+			Uint32 middle = lower + (upper - lower) / 2;
+
+			PackEntry const & entry = mEntries[middle];
+
+			int order = index.compare(0, index.size(), reinterpret_cast<char const *>(mFile.mData + entry.mNameOffset), entry.mNameLength);
+
+			if (0 == order) return &entry;
+
+			if (order < 0) upper = middle;
+
+			else lower = middle + 1;
+		}
+
+		return 0;
+	}
+
+	/// @brief Gets the contents of a file held in the pack
+	/// @param entry Entry describing the file
+	/// @return Start of file contents, valid while the pack stays open
+	/// @note Tested
+	Uint8 const * Pack::GetData (PackEntry const * entry) const
+	{
+		return mFile.mData + entry->mOffset;
+	}
+
+	/// @brief Gets the name under which a file is held in the pack
+	/// @param entry Entry describing the file
+	/// @return Name of file, with forward slashes
+	/// @note Tested
+	std::string Pack::GetName (PackEntry const * entry) const
+	{
+		return std::string(reinterpret_cast<char const *>(mFile.mData + entry->mNameOffset), entry->mNameLength);
+	}
+}
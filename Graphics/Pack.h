@@ -0,0 +1,39 @@
+#ifndef PACK_H
+#define PACK_H
+
+#include <SDL/SDL_types.h>
+
+/// @file
+/// Layout of asset packs: a header, then an index of entries sorted by name, then the
+/// entry names, then the file contents, each starting on a c_PackAlign boundary
+
+namespace Graphics
+{
+	/// @var c_PackMagic
+	/// @brief Tag opening every pack, "UIPK" in file order
+	Uint32 const c_PackMagic = 0x4B504955;
+	/// @var c_PackVersion
+	/// @brief Layout version of packs; others are not opened
+	Uint32 const c_PackVersion = 1;
+	/// @var c_PackAlign
+	/// @brief Alignment of file contents within a pack, in bytes
+	Uint32 const c_PackAlign = 16;
+
+	/// @brief Header of a pack, followed by mCount entries
+	struct PackHeader {
+		Uint32 mMagic;	///< c_PackMagic
+		Uint32 mVersion;///< c_PackVersion
+		Uint32 mCount;	///< Count of entries
+		Uint32 mReserved;	///< Zero
+	};
+
+	/// @brief Index entry of a pack, describing one file
+	struct PackEntry {
+		Uint32 mNameOffset;	///< Offset of file name from the start of the pack
+		Uint32 mNameLength;	///< Length of file name, which is not terminated
+		Uint32 mOffset;	///< Offset of file contents from the start of the pack
+		Uint32 mSize;	///< Size of file contents, in bytes
+	};
+}
+
+#endif // PACK_H
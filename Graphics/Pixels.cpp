@@ -0,0 +1,250 @@
+/// @file
+/// Conversion of decoded images and glyph coverage to the layouts used by textures
+
+#include "Graphics_Imp.h"
+#include <algorithm>
+
+namespace Graphics
+{
+	/// @brief Gets the bit position of a mask's lowest set bit
+	/// @note Tested
+	static Uint8 Shift (Uint32 mask)
+	{
+		Uint8 shift = 0;
+
+		while (mask != 0 && 0 == (mask & 1)) mask >>= 1, ++shift;
+
+		return shift;
+	}
+
+	/// @brief Rearranges 32-bit pixels into RGBA byte order
+	/// @param pDest RGBA pixels
+	/// @param pSrc Source pixels
+	/// @param count Pixel count
+	/// @param shifts Bit positions of the source red, green, blue, and alpha channels
+	/// @param bAlpha If true, the source has an alpha channel; otherwise, pixels are opaque
+	/// @note Tested
+	static void Swizzle32 (Uint32 * pDest, Uint32 const * pSrc, int count, Uint8 const shifts[4], bool bAlpha)
+	{
+		Uint8 const to[4] = { Shift(c_Rmask), Shift(c_Gmask), Shift(c_Bmask), Shift(c_Amask) };
+
+		int channels = bAlpha ? 4 : 3, index = 0;
+
+	#ifdef GRAPHICS_SSE2
+		// Move each channel into place four pixels at a time.
+		__m128i byte = _mm_set1_epi32(0xFF);
+		__m128i opaque = _mm_set1_epi32(bAlpha ? 0 : int(c_Amask));
+
+		for (; index + 4 <= count; index += 4)
+		{
+			__m128i src = _mm_loadu_si128(reinterpret_cast<__m128i const *>(pSrc + index));
+			__m128i dest = opaque;
+
+			for (int channel = 0; channel < channels; ++channel)
+			{
+				__m128i value = _mm_and_si128(_mm_srl_epi32(src, _mm_cvtsi32_si128(shifts[channel])), byte);
+
+				dest = _mm_or_si128(dest, _mm_sll_epi32(value, _mm_cvtsi32_si128(to[channel])));
+			}
+
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(pDest + index), dest);
+		}
+	#endif
+
+		for (; index < count; ++index)
+		{
+			Uint32 dest = bAlpha ? 0 : c_Amask;
+
+			for (int channel = 0; channel < channels; ++channel) dest |= ((pSrc[index] >> shifts[channel]) & 0xFF) << to[channel];
+
+			pDest[index] = dest;
+		}
+	}
+
+	/// @brief Gets an image's pixels in RGBA form, converting them only if necessary
+	/// @param pImage Image, in a software surface
+	/// @param scratch [out] Storage for converted pixels
+	/// @param pitch [out] Bytes per row of returned pixels
+	/// @return RGBA pixels, either the image's own or those in scratch
+	/// @note Tested
+	Uint8 const * GetRGBA (SDL_Surface * pImage, std::vector<Uint32> & scratch, GLsizei & pitch)
+	{
+		SDL_PixelFormat const * pFormat = pImage->format;
+
+		bool bAlpha = pFormat->Amask != 0;
+
+		// RGBA images can be used as they are.
+		if (4 == pFormat->BytesPerPixel && c_Rmask == pFormat->Rmask && c_Gmask == pFormat->Gmask && c_Bmask == pFormat->Bmask && c_Amask == pFormat->Amask)
+		{
+			pitch = pImage->pitch;
+
+			return static_cast<Uint8 const *>(pImage->pixels);
+		}
+
+		scratch.resize(pImage->w * pImage->h);
+
+		pitch = pImage->w * 4;
+
+		// Swizzle images with 8-bit channels, one row at a time.
+		bool bBytes = 0 == (pFormat->Rloss | pFormat->Gloss | pFormat->Bloss | (bAlpha ? pFormat->Aloss : 0));
+
+		if (bBytes && (3 == pFormat->BytesPerPixel || 4 == pFormat->BytesPerPixel) && 0 == (pImage->flags & SDL_SRCCOLORKEY))
+		{
+			Uint8 const shifts[4] = { pFormat->Rshift, pFormat->Gshift, pFormat->Bshift, pFormat->Ashift };
+
+			std::vector<Uint32> row(3 == pFormat->BytesPerPixel ? pImage->w : 0);
+
+			SDL_LockSurface(pImage);
+
+			for (int y = 0; y < pImage->h; ++y)
+			{
+				Uint8 const * pRow = static_cast<Uint8 const *>(pImage->pixels) + y * pImage->pitch;
+
+				// Widen packed 24-bit pixels first, keeping their channel positions.
+				if (3 == pFormat->BytesPerPixel)
+				{
+					for (int x = 0; x < pImage->w; ++x, pRow += 3)
+					{
+						row[x] = SDL_BYTEORDER == SDL_BIG_ENDIAN ? (pRow[0] << 16) | (pRow[1] << 8) | pRow[2] : pRow[0] | (pRow[1] << 8) | (pRow[2] << 16);
+					}
+
+					pRow = reinterpret_cast<Uint8 const *>(&row[0]);
+				}
+
+				Swizzle32(&scratch[y * pImage->w], reinterpret_cast<Uint32 const *>(pRow), pImage->w, shifts, bAlpha);
+			}
+
+			SDL_UnlockSurface(pImage);
+		}
+
+		// Leave palettized, color-keyed, and other formats to SDL. Alpha is copied, not
+		// blended, so that transparency survives the blit.
+		else
+		{
+			SDL_Surface * pDest = SDL_CreateRGBSurfaceFrom(&scratch[0], pImage->w, pImage->h, 32, pitch, c_Rmask, c_Gmask, c_Bmask, c_Amask);
+
+			if (0 == pDest) return 0;
+
+			std::fill(scratch.begin(), scratch.end(), 0);
+
+			SDL_SetAlpha(pImage, 0, 0);
+			SDL_BlitSurface(pImage, 0, pDest, 0);
+			SDL_FreeSurface(pDest);
+		}
+
+		return reinterpret_cast<Uint8 const *>(&scratch[0]);
+	}
+
+	/// @brief Expands alpha texels into white RGBA texels of the same alpha
+	/// @param pDest RGBA texels
+	/// @param pSrc Alpha texels
+	/// @param count Texel count
+	/// @note Tested
+	void ExpandAlpha (Uint32 * pDest, Uint8 const * pSrc, int count)
+	{
+		Uint8 const shift = Shift(c_Amask);
+
+		int index = 0;
+
+	#ifdef GRAPHICS_SSE2
+		// Widen sixteen alpha values at a time, and move them into the alpha channel.
+		__m128i zero = _mm_setzero_si128();
+		__m128i white = _mm_set1_epi32(int(~c_Amask));
+		__m128i to = _mm_cvtsi32_si128(shift);
+
+		for (; index + 16 <= count; index += 16)
+		{
+			__m128i src = _mm_loadu_si128(reinterpret_cast<__m128i const *>(pSrc + index));
+			__m128i lo = _mm_unpacklo_epi8(src, zero), hi = _mm_unpackhi_epi8(src, zero);
+			__m128i quads[4] = {
+				_mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+				_mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero)
+			};
+
+			for (int quad = 0; quad < 4; ++quad)
+			{
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(pDest + index + quad * 4), _mm_or_si128(white, _mm_sll_epi32(quads[quad], to)));
+			}
+		}
+	#endif
+
+		for (; index < count; ++index) pDest[index] = ~c_Amask | (Uint32(pSrc[index]) << shift);
+	}
+
+	/// @brief Merges glyph coverage into a run of alpha texels, keeping the greater value
+	/// where glyphs overlap
+	/// @param pDest Alpha texels
+	/// @param pSrc Coverage
+	/// @param count Texel count
+	/// @note Tested
+	void MergeCoverage (Uint8 * pDest, Uint8 const * pSrc, int count)
+	{
+		int index = 0;
+
+	#ifdef GRAPHICS_SSE2
+		for (; index + 16 <= count; index += 16)
+		{
+			__m128i dest = _mm_loadu_si128(reinterpret_cast<__m128i const *>(pDest + index));
+			__m128i src = _mm_loadu_si128(reinterpret_cast<__m128i const *>(pSrc + index));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(pDest + index), _mm_max_epu8(dest, src));
+		}
+	#endif
+
+		for (; index < count; ++index) pDest[index] = std::max(pDest[index], pSrc[index]);
+	}
+
+	/// @brief Halves RGBA pixels in each dimension, averaging each 2x2 box into one pixel
+	/// @param pDest RGBA pixels, tightly packed, of the halved size
+	/// @param pSrc RGBA pixels
+	/// @param w Source width; if odd, the last column is paired with itself
+	/// @param h Source height; if odd, the last row is paired with itself
+	/// @param pitch Bytes per row of source pixels
+	/// @note Tested
+	void HalveRGBA (Uint32 * pDest, Uint8 const * pSrc, GLsizei w, GLsizei h, GLsizei pitch)
+	{
+		GLsizei halfW = (w + 1) / 2, halfH = (h + 1) / 2;
+
+		for (GLsizei y = 0; y < halfH; ++y, pDest += halfW)
+		{
+			Uint8 const * pRow0 = pSrc + 2 * y * pitch;
+			Uint8 const * pRow1 = pSrc + std::min(2 * y + 1, h - 1) * pitch;
+
+			GLsizei x = 0;
+
+		#ifdef GRAPHICS_SSE2
+			// Average four source columns into two pixels at a time, in 16 bits per channel.
+			__m128i zero = _mm_setzero_si128();
+			__m128i round = _mm_set1_epi16(2);
+
+			for (; 2 * x + 4 <= w; x += 2)
+			{
+				__m128i top = _mm_loadu_si128(reinterpret_cast<__m128i const *>(pRow0 + 8 * x));
+				__m128i bottom = _mm_loadu_si128(reinterpret_cast<__m128i const *>(pRow1 + 8 * x));
+				__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+				__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+
+				// Add each pixel's column to its neighbor's, then put the two sums side by side.
+				lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+				hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+
+				__m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(lo, hi), round), 2);
+
+				_mm_storel_epi64(reinterpret_cast<__m128i *>(pDest + x), _mm_packus_epi16(sum, sum));
+			}
+		#endif
+
+			for (; x < halfW; ++x)
+			{
+				GLsizei x0 = 2 * x * 4, x1 = std::min(2 * x + 1, w - 1) * 4;
+
+				Uint8 * pOut = reinterpret_cast<Uint8 *>(pDest + x);
+
+				for (int channel = 0; channel < 4; ++channel)
+				{
+					pOut[channel] = Uint8((pRow0[x0 + channel] + pRow0[x1 + channel] + pRow1[x0 + channel] + pRow1[x1 + channel] + 2) >> 2);
+				}
+			}
+		}
+	}
+}
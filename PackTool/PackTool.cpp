@@ -0,0 +1,216 @@
+/// @file
+/// Offline tool building an asset pack from image and font files, for SetAssetPack
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "../Graphics/Pack.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/// @brief Adds a file to the list of those packed, or the files under a directory
+/// @param name Name of file or directory, with forward slashes
+/// @param names [in-out] Names of files to pack
+/// @return If true, the file or directory was found
+static bool Gather (std::string const & name, std::vector<std::string> & names)
+{
+	struct stat info;
+
+	if (stat(name.c_str(), &info) != 0) return false;
+
+	if (0 == (info.st_mode & S_IFDIR))
+	{
+		names.push_back(name);
+
+		return true;
+	}
+
+	DIR * dir = opendir(name.c_str());
+
+	if (0 == dir) return false;
+
+	for (struct dirent * entry; (entry = readdir(dir)) != 0; )
+	{
+		std::string file = entry->d_name;
+
+		// Skip the directory and its parent, and hidden files.
+		if ('.' == file[0]) continue;
+
+		Gather(name + "/" + file, names);
+	}
+
+	closedir(dir);
+
+	return true;
+}
+
+/// @brief Reads a whole file
+/// @param name Name of file
+/// @param data [out] On success, file contents
+/// @return If true, the file was read
+static bool Read (std::string const & name, std::vector<char> & data)
+{
+	std::ifstream file(name.c_str(), std::ios::binary);
+
+	if (!file) return false;
+
+	file.seekg(0, std::ios::end);
+
+	data.resize(size_t(file.tellg()));
+
+	file.seekg(0, std::ios::beg);
+
+	if (!data.empty()) file.read(&data[0], std::streamsize(data.size()));
+
+	return !file.fail();
+}
+
+/// @brief Pads a stream with zeroes up to an offset
+/// @param file Stream to pad
+/// @param offset Offset reached
+static void Pad (std::ofstream & file, Uint32 offset)
+{
+	while (Uint32(file.tellp()) < offset) file.put('\0');
+}
+
+/// @brief Builds a pack from the files named on the command line
+/// @return 0 on success, 1 on failure
+/// @note Files are indexed by the names given, e.g. "PackTool Assets.pack Assets/Fonts
+/// Assets/Textures" packs the files under Assets as Assets/Fonts/Vera.ttf and so on, the
+/// names the scripts load them by
+int main (int argc, char * argv[])
+{
+	if (argc < 3)
+	{
+		std::cerr << "Usage: PackTool <pack> <file or directory>..." << std::endl;
+
+		return 1;
+	}
+
+	// Gather the files, named with forward slashes, in index order.
+	std::vector<std::string> names;
+
+	for (int index = 2; index < argc; ++index)
+	{
+		std::string name = argv[index];
+
+		std::replace(name.begin(), name.end(), '\\', '/');
+
+		while (name.size() > 1 && '/' == name[name.size() - 1]) name.erase(name.size() - 1);
+
+		while (0 == name.compare(0, 2, "./")) name.erase(0, 2);
+
+		if (!Gather(name, names))
+		{
+			std::cerr << "Unable to find: " << name << std::endl;
+
+			return 1;
+		}
+	}
+
+	std::sort(names.begin(), names.end());
+
+	names.erase(std::unique(names.begin(), names.end()), names.end());
+
+	// Leave out the pack itself, e.g. when packing the directory holding it.
+	std::string pack = argv[1], temp = pack + ".tmp";
+
+	std::replace(pack.begin(), pack.end(), '\\', '/');
+	std::replace(temp.begin(), temp.end(), '\\', '/');
+
+	names.erase(std::remove(names.begin(), names.end(), pack), names.end());
+	names.erase(std::remove(names.begin(), names.end(), temp), names.end());
+
+	// Lay out the index and names, and then the contents of each file after them.
+	Graphics::PackHeader header = { Graphics::c_PackMagic, Graphics::c_PackVersion, Uint32(names.size()), 0 };
+
+	std::vector<Graphics::PackEntry> entries(names.size());
+
+	Uint32 offset = Uint32(sizeof(Graphics::PackHeader) + entries.size() * sizeof(Graphics::PackEntry));
+
+	for (size_t index = 0; index < names.size(); ++index)
+	{
+		entries[index].mNameOffset = offset;
+		entries[index].mNameLength = Uint32(names[index].size());
+
+		offset += entries[index].mNameLength;
+	}
+
+	for (size_t index = 0; index < names.size(); ++index)
+	{
+		struct stat info;
+
+		if (stat(names[index].c_str(), &info) != 0)
+		{
+			std::cerr << "Unable to read: " << names[index] << std::endl;
+
+			return 1;
+		}
+
+		offset = (offset + Graphics::c_PackAlign - 1) & ~(Graphics::c_PackAlign - 1);
+
+		entries[index].mOffset = offset;
+		entries[index].mSize = Uint32(info.st_size);
+
+		offset += entries[index].mSize;
+	}
+
+	// Write the pack under a temporary name and move it into place, so that a partly
+	// written pack is never opened.
+	std::ofstream file(temp.c_str(), std::ios::binary);
+
+	file.write(reinterpret_cast<char const *>(&header), sizeof(Graphics::PackHeader));
+
+	if (!entries.empty()) file.write(reinterpret_cast<char const *>(&entries[0]), std::streamsize(entries.size() * sizeof(Graphics::PackEntry)));
+
+	for (size_t index = 0; index < names.size(); ++index) file.write(names[index].data(), std::streamsize(names[index].size()));
+
+	for (size_t index = 0; file && index < names.size(); ++index)
+	{
+		std::vector<char> data;
+
+		// The file must not have changed since it was laid out.
+		if (!Read(names[index], data) || data.size() != entries[index].mSize)
+		{
+			std::cerr << "Unable to read: " << names[index] << std::endl;
+
+			file.close();
+
+			remove(temp.c_str());
+
+			return 1;
+		}
+
+		Pad(file, entries[index].mOffset);
+
+		if (!data.empty()) file.write(&data[0], std::streamsize(data.size()));
+	}
+
+	file.close();
+
+	bool bWritten = !file.fail();
+
+	if (bWritten)
+	{
+		remove(pack.c_str());
+
+		bWritten = 0 == rename(temp.c_str(), pack.c_str());
+	}
+
+	if (!bWritten)
+	{
+		std::cerr << "Unable to write: " << pack << std::endl;
+
+		remove(temp.c_str());
+
+		return 1;
+	}
+
+	std::cout << "Packed " << names.size() << " files into " << pack << std::endl;
+
+	return 0;
+}
@@ -10,6 +10,7 @@ extern "C"
 }
 
 void luaopen_dirent (lua_State * L);
+void luaopen_frame (lua_State * L);
 void luaopen_graphics (lua_State * L);
 void luaopen_misc (lua_State * L);
 void luaopen_sdl (lua_State * L);
@@ -17,6 +18,8 @@ void luaopen_ui (lua_State * L);
 
 void Post (lua_State * L, char const * message);
 
+void InvalidateFrame (void);
+
 Uint32 U (lua_State * L, int index);
 Uint8 U8 (lua_State * L, int index);
 Uint16 U16 (lua_State * L, int index);
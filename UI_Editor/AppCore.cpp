@@ -15,6 +15,7 @@ int main (int argc, char * argv[])
 
 	// Give Lua some useful tools.
 	luaopen_dirent(L);
+	luaopen_frame(L);
 	luaopen_graphics(L);
 	luaopen_misc(L);
 	luaopen_sdl(L);
@@ -0,0 +1,159 @@
+#include <SDL/SDL.h>
+#include "App.h"
+
+/// @var c_Wake
+/// @brief Code of the user event used to wake the frame driver
+static int const c_Wake = 0x46524D;
+
+static SDL_Event _Held;	///< Event taken from the queue while waiting
+static bool _bHeld;	///< If true, an event is held
+static volatile bool _bInvalid = true;	///< If true, a frame is due regardless of input
+
+/// @brief Indicates whether an event is the driver's wake event
+static bool IsWake (SDL_Event const & event)
+{
+	return SDL_USEREVENT == event.type && c_Wake == event.user.code;
+}
+
+/// @brief Pushes a wake event
+static void Wake (void)
+{
+	SDL_Event event;
+
+	event.type = SDL_USEREVENT;
+	event.user.code = c_Wake;
+	event.user.data1 = event.user.data2 = 0;
+
+	SDL_PushEvent(&event);
+}
+
+/// @brief Timer callback that wakes the driver once a deadline arrives
+static Uint32 WakeAt (Uint32 interval, void * param)
+{
+	Wake();
+
+	return 0;
+}
+
+/// @brief Blocks until input arrives, the deadline passes, or a frame is invalidated
+/// @param deadline Tick at which to stop waiting; ignored if bDeadline is false
+/// @param bDeadline If true, the deadline applies
+/// @return If true, input arrived
+static bool Wait (Uint32 deadline, bool bDeadline)
+{
+	// Discard wake events left over from invalidations already answered. Return at once on
+	// events already queued, invalidation, or lapsed deadlines.
+	SDL_Event event;
+
+	SDL_PumpEvents();
+
+	if (_bHeld) return true;
+
+	while (SDL_PeepEvents(&event, 1, SDL_PEEKEVENT, SDL_ALLEVENTS) > 0 && IsWake(event)) SDL_PeepEvents(&event, 1, SDL_GETEVENT, SDL_ALLEVENTS);
+
+	if (SDL_PeepEvents(&event, 1, SDL_PEEKEVENT, SDL_ALLEVENTS) > 0) return true;
+	if (_bInvalid) return false;
+
+	Uint32 now = SDL_GetTicks();
+
+	if (bDeadline && Sint32(deadline - now) <= 0) return false;
+
+	// Have a timer wake the driver at the deadline, and block. The first event is held
+	// back, so that it reaches the scripts ahead of any that follow it. An invalidation
+	// made since the flag was read has pushed a wake event, so it is not missed.
+	SDL_TimerID timer = bDeadline ? SDL_AddTimer(deadline - now, WakeAt, 0) : 0;
+
+	while (SDL_WaitEvent(&_Held) != 0 && IsWake(_Held))
+	{
+		if (_bInvalid || (bDeadline && Sint32(deadline - SDL_GetTicks()) <= 0)) break;
+	}
+
+	if (timer != 0) SDL_RemoveTimer(timer);
+
+	_bHeld = !IsWake(_Held);
+
+	return _bHeld;
+}
+
+/// @brief Requests that the frame driver run another frame
+/// @note Safe to call from any thread: the flag is set before the wake event is pushed,
+/// so a driver that misses the flag receives the event
+void InvalidateFrame (void)
+{
+	_bInvalid = true;
+
+	Wake();
+}
+
+static int Run (lua_State * L)
+{
+	luaL_checktype(L, 1, LUA_TFUNCTION);
+
+	if (!SDL_WasInit(SDL_INIT_TIMER)) SDL_InitSubSystem(SDL_INIT_TIMER);
+
+	Uint32 deadline = 0;
+
+	for (bool bDeadline = false; ; )
+	{
+		bool bInput = Wait(deadline, bDeadline);
+
+		_bInvalid = false;
+
+		// Run the frame: f() -> bContinue, deadline
+		lua_pushvalue(L, 1);
+		lua_call(L, 0, 2);
+
+		bool bContinue = lua_toboolean(L, -2) != 0;
+
+		bDeadline = lua_isnumber(L, -1) != 0;
+
+		if (bDeadline) deadline = static_cast<Uint32>(lua_tonumber(L, -1));
+
+		lua_pop(L, 2);
+
+		if (!bContinue) break;
+
+		// Input is often answered over more than one frame, e.g. by tasks that the first
+		// frame queues, so follow it with one more.
+		if (bInput) _bInvalid = true;
+	}
+
+	return 0;
+}
+
+static int PollEvent (lua_State * L)
+{
+	SDL_Event * pEvent = static_cast<SDL_Event*>(UT(L, 1));
+
+	// Supply any held event first. Skip wake events.
+	if (_bHeld)
+	{
+		*pEvent = _Held;
+
+		_bHeld = false;
+
+		lua_pushnumber(L, 1);
+
+		return 1;
+	}
+
+	int result;
+
+	while ((result = SDL_PollEvent(pEvent)) != 0 && IsWake(*pEvent));
+
+	lua_pushnumber(L, result);
+
+	return 1;
+}
+
+/// @brief Binds the frame driver to the Lua scripting system
+void luaopen_frame (lua_State * L)
+{
+	const luaL_reg FrameFuncs[] = {
+		{ "Run", Run },
+		{ "PollEvent", PollEvent },
+		{ 0, 0 }
+	};
+
+	luaL_openlib(L, "Frame", FrameFuncs, 0);
+}
@@ -2,6 +2,8 @@
 #include "../Graphics/Graphics.h"
 #include <iostream>
 #include <cassert>
+#include <cstring>
+#include <vector>
 
 #define M_(w) { #w, w }
 
@@ -51,6 +53,18 @@ static int SetBounds (lua_State * L)
 	return 0;
 }
 
+static int PushBounds (lua_State * L)
+{
+	PushBounds(F(L, 1), F(L, 2), F(L, 3), F(L, 4));
+
+	return 0;
+}
+
+static int PopBounds (lua_State * L)
+{
+	return I_V(L, PopBounds);
+}
+
 static int LoadPicture (lua_State * L)
 {
 	Picture_h picture;
@@ -65,6 +79,63 @@ static int LoadPicture (lua_State * L)
 	return 0;
 }
 
+static int LoadPictureAsync (lua_State * L)
+{
+	Picture_h picture;
+
+	if (LoadPictureAsync(S(L, 1), F(L, 2), F(L, 3), F(L, 4), F(L, 5), picture) != 0)
+	{
+		PushUserType(L, picture, "Picture");
+
+		return 1;
+	}
+
+	return 0;
+}
+
+static int LoadThumbnail (lua_State * L)
+{
+	Picture_h picture;
+
+	if (LoadThumbnail(S(L, 1), I(L, 2), F(L, 3), F(L, 4), F(L, 5), F(L, 6), picture) != 0)
+	{
+		PushUserType(L, picture, "Picture");
+
+		return 1;
+	}
+
+	return 0;
+}
+
+static int IsPictureReady (lua_State * L)
+{
+	bool bReady;
+
+	if (IsPictureReady(UT(L, 1), bReady) != 0)
+	{
+		lua_pushboolean(L, bReady);
+
+		return 1;
+	}
+
+	return 0;
+}
+
+static int GetPendingLoads (lua_State * L)
+{
+	Uint32 decoding, ready;
+
+	if (GetPendingLoads(decoding, ready) != 0)
+	{
+		lua_pushnumber(L, decoding);
+		lua_pushnumber(L, ready);
+
+		return 2;
+	}
+
+	return 0;
+}
+
 static int DrawPicture (lua_State * L)
 {
 	DrawPicture(UT(L, 1), F(L, 2), F(L, 3), F(L, 4), F(L, 5));
@@ -72,6 +143,13 @@ static int DrawPicture (lua_State * L)
 	return 0;
 }
 
+static int DrawPictureEx (lua_State * L)
+{
+	DrawPictureEx(UT(L, 1), F(L, 2), F(L, 3), F(L, 4), F(L, 5), B(L, 6), B(L, 7));
+
+	return 0;
+}
+
 static int SetPictureTexels (lua_State * L)
 {
 	SetPictureTexels(UT(L, 1), F(L, 2), F(L, 3), F(L, 4), F(L, 5));
@@ -125,6 +203,27 @@ static int GetTextSize (lua_State * L)
 	return 2;
 }
 
+static int GetTextWidths (lua_State * L)
+{
+	char const * text = S(L, 2);
+
+	std::vector<int> widths(strlen(text) + 1, 0);
+
+	GetTextWidths(UT(L, 1), text, &widths[1]);
+
+	// Return the widths as an array, with the empty prefix at index 0.
+	lua_newtable(L);
+
+	for (size_t index = 0; index < widths.size(); ++index)
+	{
+		lua_pushnumber(L, lua_Number(index));
+		lua_pushnumber(L, widths[index]);
+		lua_settable(L, -3);
+	}
+
+	return 1;
+}
+
 static int LoadTextImage (lua_State * L)
 {
 	SDL_Color color;
@@ -157,6 +256,19 @@ static int UnloadTextImage (lua_State * L)
 	return I_Ut(L, UnloadTextImage);
 }
 
+static int DrawText (lua_State * L)
+{
+	SDL_Color color;
+
+	color.r = U8(L, 5);
+	color.g = U8(L, 6);
+	color.b = U8(L, 7);
+
+	DrawText(UT(L, 1), S(L, 2), F(L, 3), F(L, 4), color);
+
+	return 0;
+}
+
 static int DrawBox (lua_State * L)
 {
 	DrawBox(F(L, 1), F(L, 2), F(L, 3), F(L, 4), F(L, 5), F(L, 6), F(L, 7));
@@ -178,6 +290,226 @@ static int DrawGrid (lua_State * L)
 	return 0;
 }
 
+static int LoadNineSlice (lua_State * L)
+{
+	NineSlice_h nineSlice;
+
+	if (LoadNineSlice(nineSlice) != 0)
+	{
+		PushUserType(L, nineSlice, "NineSlice");
+
+		return 1;
+	}
+
+	return 0;
+}
+
+static int SetNineSliceCell (lua_State * L)
+{
+	SetNineSliceCell(UT(L, 1), I(L, 2), lua_isnil(L, 3) ? 0 : UT(L, 3), B(L, 4), B(L, 5));
+
+	return 0;
+}
+
+static int SetNineSliceThresholds (lua_State * L)
+{
+	SetNineSliceThresholds(UT(L, 1), F(L, 2), F(L, 3));
+
+	return 0;
+}
+
+static int DrawNineSlice (lua_State * L)
+{
+	DrawNineSlice(UT(L, 1), F(L, 2), F(L, 3), F(L, 4), F(L, 5), lua_toboolean(L, 6) != 0);
+
+	return 0;
+}
+
+static int UnloadNineSlice (lua_State * L)
+{
+	return I_Ut(L, UnloadNineSlice);
+}
+
+static int LoadBlock (lua_State * L)
+{
+	Block_h block;
+
+	if (LoadBlock(block) != 0)
+	{
+		PushUserType(L, block, "Block");
+
+		return 1;
+	}
+
+	return 0;
+}
+
+static int BeginBlock (lua_State * L)
+{
+	return I_Ut(L, BeginBlock);
+}
+
+static int EndBlock (lua_State * L)
+{
+	return I_V(L, EndBlock);
+}
+
+static int DrawBlock (lua_State * L)
+{
+	DrawBlock(UT(L, 1), F(L, 2), F(L, 3));
+
+	return 0;
+}
+
+static int UnloadBlock (lua_State * L)
+{
+	return I_Ut(L, UnloadBlock);
+}
+
+static int LoadLayer (lua_State * L)
+{
+	Layer_h layer;
+
+	if (LoadLayer(layer) != 0)
+	{
+		PushUserType(L, layer, "Layer");
+
+		return 1;
+	}
+
+	return 0;
+}
+
+static int BeginLayer (lua_State * L)
+{
+	lua_pushboolean(L, BeginLayer(UT(L, 1), F(L, 2), F(L, 3), F(L, 4), F(L, 5)) != 0);
+
+	return 1;
+}
+
+static int EndLayer (lua_State * L)
+{
+	return I_V(L, EndLayer);
+}
+
+static int DrawLayer (lua_State * L)
+{
+	lua_pushboolean(L, DrawLayer(UT(L, 1), F(L, 2), F(L, 3)) != 0);
+
+	return 1;
+}
+
+static int UnloadLayer (lua_State * L)
+{
+	return I_Ut(L, UnloadLayer);
+}
+
+static int SelectRenderer (lua_State * L)
+{
+	lua_pushboolean(L, SelectRenderer(S(L, 1)) != 0);
+
+	return 1;
+}
+
+static int SetRenderThread (lua_State * L)
+{
+	lua_pushboolean(L, SetRenderThread(B(L, 1)) != 0);
+
+	return 1;
+}
+
+static int SaveFrame (lua_State * L)
+{
+	lua_pushboolean(L, SaveFrame(S(L, 1)) != 0);
+
+	return 1;
+}
+
+static int SetDistanceFieldFonts (lua_State * L)
+{
+	lua_pushboolean(L, SetDistanceFieldFonts(I(L, 1)) != 0);
+
+	return 1;
+}
+
+static int SetImageCache (lua_State * L)
+{
+	lua_pushboolean(L, SetImageCache(S(L, 1)) != 0);
+
+	return 1;
+}
+
+static int SetAssetPack (lua_State * L)
+{
+	lua_pushboolean(L, SetAssetPack(S(L, 1)) != 0);
+
+	return 1;
+}
+
+static int SetTextureBudget (lua_State * L)
+{
+	lua_pushboolean(L, SetTextureBudget(U(L, 1), U(L, 2)) != 0);
+
+	return 1;
+}
+
+static int SetDamageTracking (lua_State * L)
+{
+	lua_pushboolean(L, SetDamageTracking(B(L, 1)) != 0);
+
+	return 1;
+}
+
+static int GetRenderStats (lua_State * L)
+{
+	RenderStats stats;
+
+	if (GetRenderStats(stats) == 0) return 0;
+
+	lua_newtable(L);
+
+	const struct {
+		char const * mName;
+		Uint32 mValue;
+	} fields[] = {
+		{ "drawCalls", stats.mDrawCalls },
+		{ "vertices", stats.mVertices },
+		{ "textureBinds", stats.mTextureBinds },
+		{ "scissors", stats.mScissors },
+		{ "clears", stats.mClears },
+		{ "textureUploads", stats.mTextureUploads },
+		{ "stateChanges", stats.mStateChanges },
+		{ "stateSkips", stats.mStateSkips },
+		{ "textureHits", stats.mTextureHits },
+		{ "textureMisses", stats.mTextureMisses },
+		{ "textureEvictions", stats.mTextureEvictions },
+		{ "textureBytes", stats.mTextureBytes },
+		{ "culledQuads", stats.mCulledQuads },
+		{ "culledLines", stats.mCulledLines },
+		{ "targetSwitches", stats.mTargetSwitches },
+		{ "layerRenders", stats.mLayerRenders },
+		{ "damagedPixels", stats.mDamagedPixels },
+		{ "imagesPlaced", stats.mImagesPlaced },
+		{ "tilesDrawn", stats.mTilesDrawn }
+	};
+
+	for (size_t index = 0; index < sizeof(fields) / sizeof(*fields); ++index)
+	{
+		lua_pushstring(L, fields[index].mName);
+		lua_pushnumber(L, fields[index].mValue);
+		lua_settable(L, -3);
+	}
+
+	return 1;
+}
+
+static int DumpRenderCommands (lua_State * L)
+{
+	lua_pushboolean(L, DumpRenderCommands(S(L, 1)) != 0);
+
+	return 1;
+}
+
 static int GraphicsWasInit (lua_State * L)
 {
 	lua_pushboolean(L, GraphicsWasInit());
@@ -195,11 +527,26 @@ static int Unload (lua_State * L, int (*func)(void *))
 	return 0;
 }
 
+static int GC_Block (lua_State * L)
+{
+	return Unload(L, UnloadBlock);
+}
+
 static int GC_Font (lua_State * L)
 {
 	return Unload(L, UnloadFont);
 }
 
+static int GC_Layer (lua_State * L)
+{
+	return Unload(L, UnloadLayer);
+}
+
+static int GC_NineSlice (lua_State * L)
+{
+	return Unload(L, UnloadNineSlice);
+}
+
 static int GC_Picture (lua_State * L)
 {
 	return Unload(L, UnloadPicture);
@@ -215,7 +562,10 @@ void luaopen_graphics (lua_State * L)
 {
 	assert(L != 0);
 
+	RegisterUserType(L, "Block", 0, 0, GC_Block);
 	RegisterUserType(L, "Font", 0, 0, GC_Font);
+	RegisterUserType(L, "Layer", 0, 0, GC_Layer);
+	RegisterUserType(L, "NineSlice", 0, 0, GC_NineSlice);
 	RegisterUserType(L, "Picture", 0, 0, GC_Picture);
 	RegisterUserType(L, "TextImage", 0, 0, GC_TextImage);
 
@@ -227,24 +577,61 @@ void luaopen_graphics (lua_State * L)
 		M_(PrepareFrame),
 		M_(DrawFrame),
 		M_(SetBounds),
+		M_(PushBounds),
+		M_(PopBounds),
 		M_(LoadPicture),
+		M_(LoadPictureAsync),
+		M_(LoadThumbnail),
+		M_(IsPictureReady),
+		M_(GetPendingLoads),
 		M_(DrawPicture),
+		M_(DrawPictureEx),
 		M_(SetPictureTexels),
 		M_(GetPictureTexels),
 		M_(UnloadPicture),
 		M_(LoadFont),
 		M_(UnloadFont),
 		M_(GetTextSize),
+		M_(GetTextWidths),
 		M_(LoadTextImage),
 		M_(DrawTextImage),
 		M_(UnloadTextImage),
+		M_(DrawText),
 		M_(DrawBox),
 		M_(DrawLine),
 		M_(DrawGrid),
+		M_(LoadNineSlice),
+		M_(SetNineSliceCell),
+		M_(SetNineSliceThresholds),
+		M_(DrawNineSlice),
+		M_(UnloadNineSlice),
+		M_(LoadBlock),
+		M_(BeginBlock),
+		M_(EndBlock),
+		M_(DrawBlock),
+		M_(UnloadBlock),
+		M_(LoadLayer),
+		M_(BeginLayer),
+		M_(EndLayer),
+		M_(DrawLayer),
+		M_(UnloadLayer),
+		M_(SelectRenderer),
+		M_(SetRenderThread),
+		M_(SaveFrame),
+		M_(SetTextureBudget),
+		M_(SetDamageTracking),
+		M_(SetDistanceFieldFonts),
+		M_(SetImageCache),
+		M_(SetAssetPack),
+		M_(GetRenderStats),
+		M_(DumpRenderCommands),
 		{ 0, 0 }
 	};
 
 	luaL_openlib(L, "Render", RenderFuncs, 0);
+
+	// Run a frame to place each image loaded in the background once it is decoded.
+	SetLoadCallback(InvalidateFrame);
 }
 
 #undef M_
\ No newline at end of file
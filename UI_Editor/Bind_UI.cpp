@@ -53,13 +53,18 @@ static void SignalFunc (UI::Widget * widget)
 	lua_pcall(L, 5, 0, 0);
 }
 
-static void UpdateFunc (UI::Widget * widget)
+static bool UpdateFunc (UI::Widget * widget)
 {
 	lua_State * L = Method(widget, "Update");	// Update wp
 
 	AddCoordinates(L, widget);	// Update wp x y w h
 	
-	lua_pcall(L, 5, 0, 0);
+	// A true result means the update saw to the dock.
+	bool bDock = 0 == lua_pcall(L, 5, 1, 0) && lua_toboolean(L, -1) != 0;	// b
+
+	lua_pop(L, 1);
+
+	return bDock;
 }
 
 #define UW_(L, index) UDT<UI::Widget*>(L, index)
@@ -589,6 +594,11 @@ static int WidgetUntag (lua_State * L)
 	return I_T<UI::Widget>(L, &UI::Widget::Untag);
 }
 
+static int WidgetUpdateDock (lua_State * L)
+{
+	return I_T<UI::Widget>(L, &UI::Widget::UpdateDock);
+}
+
 static int WidgetGetDockHead (lua_State * L)
 {
 	return T_T<UI::Widget, UI::Widget>(L, &UI::Widget::GetDockHead);
@@ -759,6 +769,7 @@ static const luaL_reg WidgetFuncs[] = {
 	M_(Widget, SetTag),
 	M_(Widget, Unload),
 	M_(Widget, Untag),
+	M_(Widget, UpdateDock),
 	M_(Widget, GetDockHead),
 	M_(Widget, GetNextDockLink),
 	M_(Widget, GetNextFrameLink),
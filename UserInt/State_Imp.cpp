@@ -10,13 +10,22 @@ namespace UI
 	{
 	}
 
-	/// @brief Dummy signal/update handler
+	/// @brief Dummy signal handler
 	/// @param widget Unused
 	/// @note Tested
 	static void DummyW (Widget *)
 	{
 	}
 
+	/// @brief Dummy update handler
+	/// @param widget Unused
+	/// @return false, leaving the dock to be updated
+	/// @note Tested
+	static bool DummyWU (Widget *)
+	{
+		return false;
+	}
+
 	/// @brief Constructs a State object
 	/// @param eventFunc Event handler
 	/// @param signalFunc Signal handler
@@ -26,7 +35,7 @@ namespace UI
 	{
 		mEventFunc = eventFunc != 0 ? eventFunc : DummyWE;
 		mSignalFunc = signalFunc != 0 ? signalFunc : DummyW;
-		mUpdateFunc = updateFunc != 0 ? updateFunc : DummyW;
+		mUpdateFunc = updateFunc != 0 ? updateFunc : DummyWU;
 	}
 
 	/// @brief Destructs a State object
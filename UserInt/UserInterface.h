@@ -134,6 +134,7 @@ namespace UI
 		int SetTag (std::wstring const & tag);
 		int Unload (void);
 		int Untag (void);
+		int UpdateDock (void);
 
 	int GetType (WidgetType & type);
 
@@ -354,7 +355,7 @@ namespace UI
 	// Types
 		typedef void (*EventFunc)(Widget *, Event);
 		typedef void (*SignalFunc)(Widget *);
-		typedef void (*UpdateFunc)(Widget *);
+		typedef bool (*UpdateFunc)(Widget *);
 	public:
 	// Members
 		std::bitset<32> mStatus;///< Current status
@@ -238,6 +238,25 @@ namespace UI
 		return 1;
 	}
 
+	/// @brief Performs an update through the dock
+	/// @return 0 on failure, non-0 for success
+	/// @note NOP unless invoked during updating, e.g. from an update callback
+	/// @note Tested
+	int Widget::UpdateDock (void)
+	{
+		if (mState->mMode != eUpdating) return 0;
+
+		// Iterate backward through the dock, recursing on each widget.
+		if (mStatus[eCannotDockUpdate]) return 1;
+
+		for (RIter_L wIter = mDock.rbegin(); wIter != mDock.rend(); ++wIter)
+		{
+			(*wIter)->Update();
+		}
+
+		return 1;
+	}
+
 	/// @brief Gets the type
 	/// @param type [out] On success, the type
 	/// @return 0 on failure, non-0 for success
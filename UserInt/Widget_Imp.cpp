@@ -70,15 +70,10 @@ namespace UI
 	/// @note Tested
 	void Widget::Update (void)
 	{
-		if (!mStatus[eCannotUpdate]) mState->mUpdateFunc(this);
+		// The update routine may see to the dock itself, e.g. to draw it from a cache.
+		if (!mStatus[eCannotUpdate] && mState->mUpdateFunc(this)) return;
 
-		// Iterate backward through the dock, recursing on each widget.
-		if (mStatus[eCannotDockUpdate]) return;
-
-		for (RIter_L wIter = mDock.rbegin(); wIter != mDock.rend(); ++wIter)
-		{
-			(*wIter)->Update();
-		}
+		UpdateDock();
 	}
 
 	/// @brief Performs upkeep logic